@@ -0,0 +1,342 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "analysiscache.h"
+#include "wisdom.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#ifdef SNDSPEC_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace Sndspec {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char magic[8] = {'S', 'N', 'D', 'S', 'P', 'A', 'C', '1'};
+const std::string entryExtension{".dat"};
+
+// Header : fixed-size part of each entry, which is followed by the key, and then the data
+struct Header
+{
+	char magic[8];
+	uint32_t keySize;
+	int32_t numChannels;
+	int32_t numColumns;
+	int32_t numBins;
+	uint32_t compressed; // 1 : data is zlib-compressed
+	uint64_t dataSize; // size of data, as stored
+};
+
+// getEntryPath() : the filename of an entry is a hash of its key. (The key itself is stored in the entry, and checked when loading)
+fs::path getEntryPath(const std::string& directory, const std::string& key)
+{
+	return fs::path(directory) / (AnalysisCache::hash(key.data(), key.size()) + entryExtension);
+}
+
+// The bytes of the floats are stored in separate planes (all of the first bytes, then all of the second bytes etc),
+// which makes the data much more compressible, as the sign and exponent bytes of neighbouring values are usually similar
+void shuffleBytes(const std::vector<float>& values, std::vector<unsigned char>& bytes)
+{
+	const size_t n = values.size();
+	bytes.resize(n * sizeof(float));
+	const unsigned char* src = reinterpret_cast<const unsigned char*>(values.data());
+	for (size_t i = 0; i < n; i++) {
+		for (size_t k = 0; k < sizeof(float); k++) {
+			bytes[k * n + i] = src[i * sizeof(float) + k];
+		}
+	}
+}
+
+void unshuffleBytes(const std::vector<unsigned char>& bytes, std::vector<float>& values)
+{
+	const size_t n = bytes.size() / sizeof(float);
+	values.resize(n);
+	unsigned char* dst = reinterpret_cast<unsigned char*>(values.data());
+	for (size_t i = 0; i < n; i++) {
+		for (size_t k = 0; k < sizeof(float); k++) {
+			dst[i * sizeof(float) + k] = bytes[k * n + i];
+		}
+	}
+}
+
+// evict() : remove the least-recently used entries (apart from the given one) until the total size is within maxBytes
+void evict(const std::string& directory, const fs::path& keep, int64_t maxBytes)
+{
+	struct Entry
+	{
+		fs::path path;
+		fs::file_time_type time;
+		uintmax_t size;
+	};
+
+	std::vector<Entry> entries;
+	uintmax_t totalSize = 0;
+	std::error_code ec;
+	for (const auto& dirEntry : fs::directory_iterator(directory, ec)) {
+		std::error_code entryEc;
+		if (dirEntry.path().extension() != entryExtension || !dirEntry.is_regular_file(entryEc)) {
+			continue;
+		}
+
+		Entry entry{dirEntry.path(), dirEntry.last_write_time(entryEc), dirEntry.file_size(entryEc)};
+		if (!entryEc) {
+			totalSize += entry.size;
+			if (entry.path != keep) {
+				entries.push_back(entry);
+			}
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.time < b.time;
+	});
+
+	for (const Entry& entry : entries) {
+		if (totalSize <= static_cast<uintmax_t>(std::max(INT64_C(0), maxBytes))) {
+			break;
+		}
+		if (fs::remove(entry.path, ec)) {
+			totalSize -= entry.size;
+		}
+	}
+}
+
+// getDirectoryOverride() : directory set by AnalysisCache::setDirectory() (if any)
+std::string& getDirectoryOverride()
+{
+	static std::string directoryOverride;
+	return directoryOverride;
+}
+
+} // namespace
+
+std::string AnalysisCache::getDirectory()
+{
+	if (!getDirectoryOverride().empty()) {
+		return getDirectoryOverride();
+	}
+
+	const std::string directory = Wisdom::getDirectory();
+	return directory.empty() ? directory : (fs::path(directory) / "analysis").string();
+}
+
+void AnalysisCache::setDirectory(const std::string &directory)
+{
+	getDirectoryOverride() = directory;
+}
+
+std::string AnalysisCache::hash(const void *data, size_t size)
+{
+	uint64_t h = 14695981039346656037ULL;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		h = (h ^ bytes[i]) * 1099511628211ULL;
+	}
+
+	static const char hexDigits[] = "0123456789abcdef";
+	std::string s(16, '0');
+	for (int i = 15; i >= 0; i--, h >>= 4) {
+		s[i] = hexDigits[h & 0xf];
+	}
+
+	return s;
+}
+
+std::string AnalysisCache::getFileKey(const std::string &filename)
+{
+	std::error_code ec;
+	const fs::path path = fs::canonical(filename, ec);
+	if (ec) {
+		return {};
+	}
+
+	const uintmax_t size = fs::file_size(path, ec);
+	if (ec) {
+		return {};
+	}
+
+	const auto modified = fs::last_write_time(path, ec);
+	if (ec) {
+		return {};
+	}
+
+	return "file=" + path.string() + ";size=" + std::to_string(size) + ";modified=" + std::to_string(modified.time_since_epoch().count());
+}
+
+template <typename FloatType>
+bool AnalysisCache::load(const std::string &key, SpectrogramResults<FloatType> &results)
+{
+	const std::string directory = getDirectory();
+	if (directory.empty() || key.empty()) {
+		return false;
+	}
+
+	const fs::path entryPath = getEntryPath(directory, key);
+	std::ifstream f(entryPath, std::ios::binary);
+	if (!f) {
+		return false;
+	}
+
+	Header header;
+	f.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!f || std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.keySize != key.size()
+			|| header.numChannels != results.getNumChannels() || header.numColumns != results.getNumColumns() || header.numBins != results.getNumBins()) {
+		return false;
+	}
+
+	std::string storedKey(header.keySize, '\0');
+	f.read(storedKey.data(), static_cast<std::streamsize>(storedKey.size()));
+	if (!f || storedKey != key) {
+		return false; // (different key, with the same hash)
+	}
+
+	const size_t numValues = static_cast<size_t>(header.numChannels) * header.numColumns * header.numBins;
+	std::vector<unsigned char> bytes(numValues * sizeof(float));
+
+	if (header.compressed != 0) {
+#ifdef SNDSPEC_ZLIB
+		std::vector<unsigned char> compressed(header.dataSize);
+		f.read(reinterpret_cast<char*>(compressed.data()), static_cast<std::streamsize>(compressed.size()));
+		uLongf size = static_cast<uLongf>(bytes.size());
+		if (!f || uncompress(bytes.data(), &size, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK || size != bytes.size()) {
+			return false;
+		}
+#else
+		return false;
+#endif
+	} else {
+		if (header.dataSize != bytes.size()) {
+			return false;
+		}
+		f.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		if (!f) {
+			return false;
+		}
+	}
+
+	std::vector<float> values;
+	unshuffleBytes(bytes, values);
+
+	// the values are stored bin-major, without padding
+	const float* src = values.data();
+	for (int c = 0; c < header.numChannels; c++) {
+		for (int b = 0; b < header.numBins; b++) {
+			FloatType* row = results.row(c, b);
+			for (int x = 0; x < header.numColumns; x++) {
+				row[x * results.getColumnStride()] = static_cast<FloatType>(*src++);
+			}
+		}
+	}
+
+	// mark the entry as recently used
+	f.close();
+	std::error_code ec;
+	fs::last_write_time(entryPath, fs::file_time_type::clock::now(), ec);
+
+	return true;
+}
+
+template <typename FloatType>
+bool AnalysisCache::save(const std::string &key, const SpectrogramResults<FloatType> &results, int64_t maxBytes)
+{
+	const std::string directory = getDirectory();
+	if (directory.empty() || key.empty()) {
+		return false;
+	}
+
+	std::error_code ec;
+	fs::create_directories(directory, ec);
+	if (ec) {
+		return false;
+	}
+
+	std::vector<float> values;
+	values.reserve(static_cast<size_t>(results.getNumChannels()) * results.getNumColumns() * results.getNumBins());
+	for (int c = 0; c < results.getNumChannels(); c++) {
+		for (int b = 0; b < results.getNumBins(); b++) {
+			const FloatType* row = results.row(c, b);
+			for (int x = 0; x < results.getNumColumns(); x++) {
+				values.push_back(static_cast<float>(row[x * results.getColumnStride()]));
+			}
+		}
+	}
+
+	std::vector<unsigned char> bytes;
+	shuffleBytes(values, bytes);
+
+	Header header{};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.keySize = static_cast<uint32_t>(key.size());
+	header.numChannels = results.getNumChannels();
+	header.numColumns = results.getNumColumns();
+	header.numBins = results.getNumBins();
+	header.compressed = 0;
+
+#ifdef SNDSPEC_ZLIB
+	std::vector<unsigned char> compressed(compressBound(static_cast<uLong>(bytes.size())));
+	uLongf compressedSize = static_cast<uLongf>(compressed.size());
+	if (compress2(compressed.data(), &compressedSize, bytes.data(), static_cast<uLong>(bytes.size()), Z_BEST_SPEED) == Z_OK) {
+		compressed.resize(compressedSize);
+		bytes.swap(compressed);
+		header.compressed = 1;
+	}
+#endif
+
+	header.dataSize = bytes.size();
+
+	// write to a temporary file and then rename it, so that concurrent instances of sndspec never see a partially-written entry
+	static std::atomic<int> counter{0};
+	const fs::path entryPath = getEntryPath(directory, key);
+	const fs::path tmpPath = fs::path(entryPath).concat(".tmp" + std::to_string(getpid()) + "-" + std::to_string(counter++));
+	std::ofstream f(tmpPath, std::ios::binary);
+	f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	f.write(key.data(), static_cast<std::streamsize>(key.size()));
+	f.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+	// (the last of the data is only written when the file is closed, so a short or failed write may only show up then)
+	f.close();
+	if (f.fail()) {
+		fs::remove(tmpPath, ec);
+		return false;
+	}
+
+	fs::rename(tmpPath, entryPath, ec);
+	if (ec) {
+		fs::remove(tmpPath, ec);
+		return false;
+	}
+
+	evict(directory, entryPath, maxBytes);
+	return true;
+}
+
+// explicit instantiations
+template bool AnalysisCache::load(const std::string &key, SpectrogramResults<float> &results);
+template bool AnalysisCache::load(const std::string &key, SpectrogramResults<double> &results);
+template bool AnalysisCache::save(const std::string &key, const SpectrogramResults<float> &results, int64_t maxBytes);
+template bool AnalysisCache::save(const std::string &key, const SpectrogramResults<double> &results, int64_t maxBytes);
+
+} // namespace Sndspec
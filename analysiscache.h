@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include "spectrogramresults.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Sndspec {
+
+// class AnalysisCache : persistent store of spectrogram analysis results (magnitude-squared, before any mapping to dB or colors),
+// so that a file can be re-rendered (eg with a different dynamic range or background) without being decoded and analyzed again.
+// Entries are kept in the "analysis" subdirectory of the wisdom directory (see Wisdom::getDirectory()), one file per entry.
+// Each entry is identified by a key, which describes everything that the results depend on (see getFileKey()).
+// The results are stored as 32-bit floats (compressed, when sndspec is built with zlib).
+// When the total size of the entries exceeds the budget, the least-recently used entries are removed.
+
+class AnalysisCache
+{
+public:
+	// getDirectory() : returns directory for storing analysis results (or an empty string if it can't be determined)
+	static std::string getDirectory();
+
+	// setDirectory() : use the given directory instead of the default one (an empty string restores the default)
+	static void setDirectory(const std::string& directory);
+
+	// getFileKey() : returns a key which identifies the current contents of a file (by its path, size and modification time),
+	// to which the caller adds the analysis parameters. Returns an empty string if the file can't be found
+	static std::string getFileKey(const std::string& filename);
+
+	// hash() : returns a 64-bit (FNV-1a) hash of the given bytes, as a hexadecimal string. (For adding large parameters, such as the window, to a key)
+	static std::string hash(const void* data, size_t size);
+
+	// load() : look up the given key. On success, fills results (which must already have the dimensions of the stored results) and returns true
+	template <typename FloatType>
+	static bool load(const std::string& key, SpectrogramResults<FloatType>& results);
+
+	// save() : store results under the given key, and then remove the least-recently used entries until the cache fits within maxBytes.
+	// Returns true on success
+	template <typename FloatType>
+	static bool save(const std::string& key, const SpectrogramResults<FloatType>& results, int64_t maxBytes);
+};
+
+} // namespace Sndspec
+
+#endif // ANALYSISCACHE_H
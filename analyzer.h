@@ -0,0 +1,181 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include "fftwtraits.h"
+#include "plancache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace Sndspec {
+
+// Analyzer<FloatType> : a real-to-complex FFT of a given size, with its own (fftw-allocated) input and output buffers.
+// FloatType may be double (fftw) or float (fftwf)
+// Plans and buffers are obtained from the PlanCache, so creating and destroying Analyzers is cheap, once a given size has been planned.
+// (An Analyzer for a one-off size can be created with cached = false, in which case it owns its plan and buffers, and frees them when destroyed)
+// An Analyzer may be given a batchSize of more than 1, in which case it has batchSize input / output slots,
+// and exec() transforms all of the slots with a single (fftw_plan_many_dft_r2c) plan.
+// This reduces per-transform overhead, and lets fftw use SIMD across transforms, which helps at small FFT sizes.
+// Each slot begins on a 64-byte boundary.
+
+template <typename FloatType>
+class Analyzer
+{
+public:
+	using Complex = typename FFTW<FloatType>::Complex;
+
+	Analyzer(int fft_size, int batchSize = 1, bool cached = true)
+		: fftSize(fft_size), spectrumSize(static_cast<int>(fft_size / 2.0) + 1), batchSize(std::max(1, batchSize)), cached(cached)
+	{
+		constexpr int alignment = 64;
+		constexpr int realsPerAlignment = alignment / sizeof(FloatType);
+		constexpr int complexesPerAlignment = alignment / sizeof(Complex);
+		tdDist = (fftSize + realsPerAlignment - 1) / realsPerAlignment * realsPerAlignment;
+		fdDist = (spectrumSize + complexesPerAlignment - 1) / complexesPerAlignment * complexesPerAlignment;
+
+		const unsigned flags = getPlannerEffort() | FFTW_PRESERVE_INPUT;
+		if (cached) {
+			PlanCache<FloatType>& planCache = PlanCache<FloatType>::getInstance();
+			tdBuf = planCache.acquireReal(getTdBufSize());
+			fdBuf = planCache.acquireComplex(getFdBufSize());
+			plan = planCache.getPlan(fftSize, Analyzer::batchSize, tdDist, fdDist, flags, tdBuf, fdBuf);
+		} else {
+			tdBuf = FFTW<FloatType>::allocReal(getTdBufSize());
+			fdBuf = FFTW<FloatType>::allocComplex(getFdBufSize());
+			plan = PlanCache<FloatType>::makePlan(fftSize, Analyzer::batchSize, tdDist, fdDist, flags, tdBuf, fdBuf);
+		}
+
+		// (buffers may have been used before, or overwritten by planning)
+		std::fill(tdBuf, tdBuf + getTdBufSize(), FloatType{0});
+	}
+
+	~Analyzer()
+	{
+		if (cached) {
+			PlanCache<FloatType>& planCache = PlanCache<FloatType>::getInstance();
+			planCache.releaseReal(tdBuf, getTdBufSize());
+			planCache.releaseComplex(fdBuf, getFdBufSize());
+		} else {
+			PlanCache<FloatType>::destroyPlan(plan);
+			FFTW<FloatType>::free(tdBuf);
+			FFTW<FloatType>::free(fdBuf);
+		}
+	}
+
+	Analyzer(const Analyzer&) = delete;
+	Analyzer& operator=(const Analyzer&) = delete;
+
+	// exec() : transform all slots
+	void exec()
+	{
+		FFTW<FloatType>::executeR2C(plan, tdBuf, fdBuf);
+	}
+
+	FloatType* getTdBuf(int slot = 0) const
+	{
+		return tdBuf + static_cast<ptrdiff_t>(slot) * tdDist;
+	}
+
+	const Complex* getFdBuf(int slot = 0) const
+	{
+		return fdBuf + static_cast<ptrdiff_t>(slot) * fdDist;
+	}
+
+	int getFFTSize() const
+	{
+		return fftSize;
+	}
+
+	int getSpectrumSize() const
+	{
+		return spectrumSize;
+	}
+
+	int getBatchSize() const
+	{
+		return batchSize;
+	}
+
+	void calcMagSquared(std::vector<FloatType>& buf)
+	{
+		calcMagSquared(buf.data());
+	}
+
+	// calcMagSquared() : write to (possibly strided) destination
+	void calcMagSquared(FloatType* buf, ptrdiff_t stride = 1)
+	{
+		calcMagSquared(0, buf, stride);
+	}
+
+	// calcMagSquared() : magnitude-squared of the given slot
+	void calcMagSquared(int slot, FloatType* buf, ptrdiff_t stride)
+	{
+		const Complex* p = getFdBuf(slot);
+		for (int b = 0; b < spectrumSize; b++) {
+			FloatType re = p[b][0];
+			FloatType im = p[b][1];
+			buf[b * stride] = re * re + im * im;
+		}
+	}
+
+	// accumulateMagSquared() : add magnitude-squared of the given slot to (possibly strided) acc
+	template <typename AccType>
+	void accumulateMagSquared(int slot, AccType* acc, ptrdiff_t stride = 1) const
+	{
+		const Complex* p = getFdBuf(slot);
+		for (int b = 0; b < spectrumSize; b++) {
+			AccType re = p[b][0];
+			AccType im = p[b][1];
+			acc[b * stride] += re * re + im * im;
+		}
+	}
+
+	// maxMagSquared() : replace each element of (possibly strided) acc with the magnitude-squared of the given slot, where greater
+	template <typename AccType>
+	void maxMagSquared(int slot, AccType* acc, ptrdiff_t stride = 1) const
+	{
+		const Complex* p = getFdBuf(slot);
+		for (int b = 0; b < spectrumSize; b++) {
+			AccType re = p[b][0];
+			AccType im = p[b][1];
+			acc[b * stride] = std::max(acc[b * stride], re * re + im * im);
+		}
+	}
+
+protected:
+	typename FFTW<FloatType>::Plan plan; // (owned by PlanCache, unless not cached)
+	int fftSize;
+	int spectrumSize;
+	int batchSize;
+	int tdDist; // distance between slots of tdBuf
+	int fdDist; // distance between slots of fdBuf
+	bool cached; // plan and buffers come from (and return to) the PlanCache
+
+	// C -facing:
+	FloatType* tdBuf;	// time-domain buffer
+	Complex* fdBuf; // frequency-domain buffer
+
+	size_t getTdBufSize() const
+	{
+		return static_cast<size_t>(tdDist) * batchSize;
+	}
+
+	size_t getFdBufSize() const
+	{
+		return static_cast<size_t>(fdDist) * batchSize;
+	}
+};
+
+} // namespace Sndspec
+
+#endif // ANALYZER_H
@@ -0,0 +1,198 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace Sndspec {
+
+// getNumBatchWorkers() : number of worker threads to use for a batch of numItems items, given the requested number of jobs
+inline int getNumBatchWorkers(size_t numItems, int numJobs)
+{
+	return static_cast<int>(std::max(size_t{1}, std::min(numItems, static_cast<size_t>(std::max(1, numJobs)))));
+}
+
+// runBatch() : calls func(itemIndex, workerIndex, log) for each item in [0, numItems), using up to numJobs worker threads.
+// Items are handed out to workers in order, as each worker becomes free.
+// workerIndex is in the range [0, getNumBatchWorkers(numItems, numJobs)), and identifies which worker is processing the item,
+// so that the caller can give each worker its own set of resources.
+// Each item writes its console output to its own log, and the logs are sent to std::cout in item order
+// (as soon as all preceding items are complete), so that the console output doesn't depend on the number of jobs.
+
+template <typename Func>
+void runBatch(size_t numItems, int numJobs, Func func)
+{
+	const int numWorkers = getNumBatchWorkers(numItems, numJobs);
+
+	if (numWorkers == 1) {
+		// no threads required; write directly to std::cout
+		for (size_t i = 0; i < numItems; i++) {
+			func(i, 0, std::cout);
+		}
+		return;
+	}
+
+	std::vector<std::ostringstream> logs(numItems);
+	std::vector<bool> done(numItems, false);
+	std::atomic<size_t> nextItem{0};
+	std::mutex doneMutex;
+	std::condition_variable doneCondition;
+
+	std::vector<std::thread> workers;
+	workers.reserve(numWorkers);
+	for (int w = 0; w < numWorkers; w++) {
+		workers.emplace_back([&, w]() {
+			size_t i;
+			while ((i = nextItem++) < numItems) {
+				func(i, w, logs[i]);
+				{
+					std::lock_guard<std::mutex> lock(doneMutex);
+					done[i] = true;
+				}
+				doneCondition.notify_all();
+			}
+		});
+	}
+
+	// flush the logs in item order
+	for (size_t i = 0; i < numItems; i++) {
+		{
+			std::unique_lock<std::mutex> lock(doneMutex);
+			doneCondition.wait(lock, [&done, i]() {
+				return done[i];
+			});
+		}
+		std::cout << logs[i].str() << std::flush;
+		logs[i] = std::ostringstream{}; // release memory
+	}
+
+	for (auto& t : workers) {
+		t.join();
+	}
+}
+
+// getNumThreads() : resolve a requested number of threads. Zero means "automatic" : share the hardware threads among numJobs jobs.
+inline int getNumThreads(int requestedThreads, int numJobs = 1)
+{
+	if (requestedThreads > 0) {
+		return requestedThreads;
+	}
+
+	const int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+	return std::max(1, hardwareThreads / std::max(1, numJobs));
+}
+
+// runWorkStealing() : calls func(threadIndex, begin, end) for consecutive sub-ranges of [0, count),
+// covering the whole range exactly once, using up to numThreads threads.
+// Each thread starts with its own contiguous share of the range, and works through it from the front in chunks of chunkSize.
+// A thread which runs out of work steals the back half of the remaining work of another thread.
+// All sub-ranges begin on a multiple of chunkSize, so that threads don't share cache lines when writing to adjacent parts of an array.
+// Each thread therefore mostly processes contiguous runs of the range (which is good for locality),
+// while the load remains balanced if some chunks take longer than others.
+// threadIndex is in the range [0, numThreads), so that the caller can give each thread its own set of resources.
+
+template <typename Func>
+void runWorkStealing(int64_t count, int numThreads, int64_t chunkSize, Func func)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	chunkSize = std::max(INT64_C(1), chunkSize);
+	const int64_t numChunks = (count + chunkSize - 1) / chunkSize;
+	numThreads = static_cast<int>(std::max(INT64_C(1), std::min(static_cast<int64_t>(numThreads), numChunks)));
+
+	if (numThreads == 1) {
+		func(0, INT64_C(0), count);
+		return;
+	}
+
+	struct WorkRange
+	{
+		std::mutex mutex;
+		int64_t begin{0}; // in chunks
+		int64_t end{0}; // in chunks
+	};
+
+	std::vector<WorkRange> ranges(numThreads);
+	for (int t = 0; t < numThreads; t++) {
+		ranges[t].begin = numChunks * t / numThreads;
+		ranges[t].end = numChunks * (t + 1) / numThreads;
+	}
+
+	auto worker = [&ranges, numThreads, count, chunkSize, &func](int t) {
+		WorkRange& own = ranges[t];
+		for (;;) {
+			// take a chunk from the front of own range
+			int64_t chunk = -1;
+			{
+				std::lock_guard<std::mutex> lock(own.mutex);
+				if (own.begin < own.end) {
+					chunk = own.begin++;
+				}
+			}
+
+			if (chunk >= 0) {
+				func(t, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+				continue;
+			}
+
+			// own range exhausted: steal the back half of another thread's remaining range
+			bool stolen = false;
+			for (int i = 1; i < numThreads && !stolen; i++) {
+				WorkRange& victim = ranges[(t + i) % numThreads];
+				int64_t stolenBegin;
+				int64_t stolenEnd;
+				{
+					std::lock_guard<std::mutex> lock(victim.mutex);
+					const int64_t remaining = victim.end - victim.begin;
+					if (remaining <= 0) {
+						continue;
+					}
+					stolenEnd = victim.end;
+					stolenBegin = victim.begin + remaining / 2;
+					victim.end = stolenBegin;
+				}
+				std::lock_guard<std::mutex> lock(own.mutex);
+				own.begin = stolenBegin;
+				own.end = stolenEnd;
+				stolen = true;
+			}
+
+			if (!stolen) {
+				return; // nothing left anywhere
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for (int t = 1; t < numThreads; t++) {
+		threads.emplace_back(worker, t);
+	}
+	worker(0); // calling thread does its share too
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+} // namespace Sndspec
+
+#endif // BATCH_H
@@ -0,0 +1,416 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "decibels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SNDSPEC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace Sndspec {
+
+// log2 approximation:
+// x = m * 2^e, with m normalised to [sqrt(0.5), sqrt(2)), so that
+// log2(x) = e + log2(m) = e + (2 / ln2) * atanh(t), where t = (m - 1) / (m + 1) and |t| <= 0.1716
+// atanh(t) = t + t^3/3 + t^5/5 + t^7/7 + t^9/9 + ...  (truncation error < 1e-9 over the range of t)
+
+namespace {
+
+constexpr double ln2 = 0.69314718055994530942;
+constexpr double log10_2 = 0.30102999566398119521;
+constexpr double sqrt2 = 1.41421356237309504880;
+constexpr double c1 = 2.0 / ln2;
+constexpr double c3 = 2.0 / (3.0 * ln2);
+constexpr double c5 = 2.0 / (5.0 * ln2);
+constexpr double c7 = 2.0 / (7.0 * ln2);
+constexpr double c9 = 2.0 / (9.0 * ln2);
+
+constexpr uint64_t mantissaMask = UINT64_C(0x000fffffffffffff);
+constexpr uint64_t exponentOne = UINT64_C(0x3ff0000000000000); // exponent bits of 1.0
+constexpr uint64_t magicBits = UINT64_C(0x4330000000000000); // 2^52 : used for converting exponent bits to double
+constexpr double magic = 4503599627370496.0; // 2^52
+
+// fastLog2() : scalar version of the approximation (used for the tails of the vectorised loops). x must be positive and normal
+inline double fastLog2(double x)
+{
+	uint64_t bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+	double e = static_cast<double>(static_cast<int>(bits >> 52) - 1023);
+	uint64_t mBits = (bits & mantissaMask) | exponentOne;
+	double m;
+	std::memcpy(&m, &mBits, sizeof(m));
+	if (m >= sqrt2) {
+		m *= 0.5;
+		e += 1.0;
+	}
+	const double t = (m - 1.0) / (m + 1.0);
+	const double t2 = t * t;
+	return e + t * (c1 + t2 * (c3 + t2 * (c5 + t2 * (c7 + t2 * c9))));
+}
+
+inline void convertTail(double* data, size_t begin, size_t n, double scale, double floor, double k)
+{
+	for (size_t i = begin; i < n; i++) {
+		data[i] = k * fastLog2(std::max(scale * data[i], floor));
+	}
+}
+
+template <typename FloatType>
+inline FloatType findPeakTail(const FloatType* data, size_t begin, size_t n, FloatType peak)
+{
+	for (size_t i = begin; i < n; i++) {
+		peak = std::max(peak, data[i]);
+	}
+	return peak;
+}
+
+#ifdef SNDSPEC_X86_SIMD
+
+// --- SSE2 ---
+
+__attribute__((target("sse2")))
+inline __m128d log2SSE2(__m128d x)
+{
+	const __m128i bits = _mm_castpd_si128(x);
+	__m128d e = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 52), _mm_set1_epi64x(magicBits))), _mm_set1_pd(magic + 1023.0));
+	__m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(mantissaMask)), _mm_set1_epi64x(exponentOne)));
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d big = _mm_cmpge_pd(m, _mm_set1_pd(sqrt2));
+	m = _mm_or_pd(_mm_and_pd(big, _mm_mul_pd(m, _mm_set1_pd(0.5))), _mm_andnot_pd(big, m));
+	e = _mm_add_pd(e, _mm_and_pd(big, one));
+	const __m128d t = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+	const __m128d t2 = _mm_mul_pd(t, t);
+	__m128d p = _mm_add_pd(_mm_set1_pd(c7), _mm_mul_pd(t2, _mm_set1_pd(c9)));
+	p = _mm_add_pd(_mm_set1_pd(c5), _mm_mul_pd(t2, p));
+	p = _mm_add_pd(_mm_set1_pd(c3), _mm_mul_pd(t2, p));
+	p = _mm_add_pd(_mm_set1_pd(c1), _mm_mul_pd(t2, p));
+	return _mm_add_pd(e, _mm_mul_pd(t, p));
+}
+
+__attribute__((target("sse2")))
+void convertSSE2(double* data, size_t n, double scale, double floor, double k)
+{
+	const __m128d vScale = _mm_set1_pd(scale);
+	const __m128d vFloor = _mm_set1_pd(floor);
+	const __m128d vK = _mm_set1_pd(k);
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		const __m128d x = _mm_max_pd(_mm_mul_pd(_mm_loadu_pd(data + i), vScale), vFloor);
+		_mm_storeu_pd(data + i, _mm_mul_pd(vK, log2SSE2(x)));
+	}
+	convertTail(data, i, n, scale, floor, k);
+}
+
+__attribute__((target("sse2")))
+double findPeakSSE2(const double* data, size_t n)
+{
+	__m128d a = _mm_setzero_pd();
+	__m128d b = _mm_setzero_pd();
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		a = _mm_max_pd(a, _mm_loadu_pd(data + i));
+		b = _mm_max_pd(b, _mm_loadu_pd(data + i + 2));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, _mm_max_pd(a, b));
+	return findPeakTail(data, i, n, std::max(lanes[0], lanes[1]));
+}
+
+__attribute__((target("sse2")))
+float findPeakSSE2(const float* data, size_t n)
+{
+	__m128 a = _mm_setzero_ps();
+	__m128 b = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		a = _mm_max_ps(a, _mm_loadu_ps(data + i));
+		b = _mm_max_ps(b, _mm_loadu_ps(data + i + 4));
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_max_ps(a, b));
+	return findPeakTail(data, i, n, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+}
+
+// --- AVX2 ---
+
+__attribute__((target("avx2,fma")))
+inline __m256d log2AVX2(__m256d x)
+{
+	const __m256i bits = _mm256_castpd_si256(x);
+	__m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(magicBits))), _mm256_set1_pd(magic + 1023.0));
+	__m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(mantissaMask)), _mm256_set1_epi64x(exponentOne)));
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(sqrt2), _CMP_GE_OQ);
+	m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+	e = _mm256_add_pd(e, _mm256_and_pd(big, one));
+	const __m256d t = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+	const __m256d t2 = _mm256_mul_pd(t, t);
+	__m256d p = _mm256_fmadd_pd(t2, _mm256_set1_pd(c9), _mm256_set1_pd(c7));
+	p = _mm256_fmadd_pd(t2, p, _mm256_set1_pd(c5));
+	p = _mm256_fmadd_pd(t2, p, _mm256_set1_pd(c3));
+	p = _mm256_fmadd_pd(t2, p, _mm256_set1_pd(c1));
+	return _mm256_fmadd_pd(t, p, e);
+}
+
+__attribute__((target("avx2,fma")))
+void convertAVX2(double* data, size_t n, double scale, double floor, double k)
+{
+	const __m256d vScale = _mm256_set1_pd(scale);
+	const __m256d vFloor = _mm256_set1_pd(floor);
+	const __m256d vK = _mm256_set1_pd(k);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256d x = _mm256_max_pd(_mm256_mul_pd(_mm256_loadu_pd(data + i), vScale), vFloor);
+		_mm256_storeu_pd(data + i, _mm256_mul_pd(vK, log2AVX2(x)));
+	}
+	convertTail(data, i, n, scale, floor, k);
+}
+
+__attribute__((target("avx2")))
+double findPeakAVX2(const double* data, size_t n)
+{
+	__m256d a = _mm256_setzero_pd();
+	__m256d b = _mm256_setzero_pd();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		a = _mm256_max_pd(a, _mm256_loadu_pd(data + i));
+		b = _mm256_max_pd(b, _mm256_loadu_pd(data + i + 4));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, _mm256_max_pd(a, b));
+	return findPeakTail(data, i, n, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+}
+
+__attribute__((target("avx2")))
+float findPeakAVX2(const float* data, size_t n)
+{
+	__m256 a = _mm256_setzero_ps();
+	__m256 b = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		a = _mm256_max_ps(a, _mm256_loadu_ps(data + i));
+		b = _mm256_max_ps(b, _mm256_loadu_ps(data + i + 8));
+	}
+	const __m256 m = _mm256_max_ps(a, b);
+	const __m128 m4 = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+	float lanes[4];
+	_mm_storeu_ps(lanes, m4);
+	return findPeakTail(data, i, n, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+}
+
+// --- AVX-512 ---
+
+// some versions of gcc issue spurious 'uninitialized' warnings from within the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f")))
+inline __m512d log2AVX512(__m512d x)
+{
+	const __m512i bits = _mm512_castpd_si512(x);
+	__m512d e = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(bits, 52), _mm512_set1_epi64(magicBits))), _mm512_set1_pd(magic + 1023.0));
+	__m512d m = _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi64(mantissaMask)), _mm512_set1_epi64(exponentOne)));
+	const __m512d one = _mm512_set1_pd(1.0);
+	const __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(sqrt2), _CMP_GE_OQ);
+	m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+	e = _mm512_mask_add_pd(e, big, e, one);
+	const __m512d t = _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+	const __m512d t2 = _mm512_mul_pd(t, t);
+	__m512d p = _mm512_fmadd_pd(t2, _mm512_set1_pd(c9), _mm512_set1_pd(c7));
+	p = _mm512_fmadd_pd(t2, p, _mm512_set1_pd(c5));
+	p = _mm512_fmadd_pd(t2, p, _mm512_set1_pd(c3));
+	p = _mm512_fmadd_pd(t2, p, _mm512_set1_pd(c1));
+	return _mm512_fmadd_pd(t, p, e);
+}
+
+__attribute__((target("avx512f")))
+void convertAVX512(double* data, size_t n, double scale, double floor, double k)
+{
+	const __m512d vScale = _mm512_set1_pd(scale);
+	const __m512d vFloor = _mm512_set1_pd(floor);
+	const __m512d vK = _mm512_set1_pd(k);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m512d x = _mm512_max_pd(_mm512_mul_pd(_mm512_loadu_pd(data + i), vScale), vFloor);
+		_mm512_storeu_pd(data + i, _mm512_mul_pd(vK, log2AVX512(x)));
+	}
+	convertTail(data, i, n, scale, floor, k);
+}
+
+__attribute__((target("avx512f")))
+double findPeakAVX512(const double* data, size_t n)
+{
+	__m512d a = _mm512_setzero_pd();
+	__m512d b = _mm512_setzero_pd();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		a = _mm512_max_pd(a, _mm512_loadu_pd(data + i));
+		b = _mm512_max_pd(b, _mm512_loadu_pd(data + i + 8));
+	}
+	return findPeakTail(data, i, n, _mm512_reduce_max_pd(_mm512_max_pd(a, b)));
+}
+
+__attribute__((target("avx512f")))
+float findPeakAVX512(const float* data, size_t n)
+{
+	__m512 a = _mm512_setzero_ps();
+	__m512 b = _mm512_setzero_ps();
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		a = _mm512_max_ps(a, _mm512_loadu_ps(data + i));
+		b = _mm512_max_ps(b, _mm512_loadu_ps(data + i + 16));
+	}
+	return findPeakTail(data, i, n, _mm512_reduce_max_ps(_mm512_max_ps(a, b)));
+}
+
+#pragma GCC diagnostic pop
+
+#endif // SNDSPEC_X86_SIMD
+
+Decibels::SimdLevel detectSimdLevel()
+{
+#ifdef SNDSPEC_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		return Decibels::SimdAVX512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return Decibels::SimdAVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return Decibels::SimdSSE2;
+	}
+#endif
+	return Decibels::SimdNone;
+}
+
+std::atomic<int>& selectedSimdLevel()
+{
+	static std::atomic<int> level{Decibels::getSupportedSimdLevel()};
+	return level;
+}
+
+} // namespace
+
+Decibels::SimdLevel Decibels::getSupportedSimdLevel()
+{
+	static const SimdLevel supported = detectSimdLevel();
+	return supported;
+}
+
+Decibels::SimdLevel Decibels::getSimdLevel()
+{
+	return static_cast<SimdLevel>(selectedSimdLevel().load());
+}
+
+void Decibels::setSimdLevel(SimdLevel level)
+{
+	selectedSimdLevel() = std::min(level, getSupportedSimdLevel());
+}
+
+std::string Decibels::getSimdLevelName(SimdLevel level)
+{
+	switch (level) {
+	case SimdSSE2:
+		return "SSE2";
+	case SimdAVX2:
+		return "AVX2";
+	case SimdAVX512:
+		return "AVX-512";
+	case SimdNone:
+		break;
+	}
+	return "none";
+}
+
+double Decibels::findPeak(const double* data, size_t n)
+{
+	switch (getSimdLevel()) {
+#ifdef SNDSPEC_X86_SIMD
+	case SimdAVX512:
+		return findPeakAVX512(data, n);
+	case SimdAVX2:
+		return findPeakAVX2(data, n);
+	case SimdSSE2:
+		return findPeakSSE2(data, n);
+#endif
+	default:
+		return findPeakReference(data, n);
+	}
+}
+
+float Decibels::findPeak(const float* data, size_t n)
+{
+	switch (getSimdLevel()) {
+#ifdef SNDSPEC_X86_SIMD
+	case SimdAVX512:
+		return findPeakAVX512(data, n);
+	case SimdAVX2:
+		return findPeakAVX2(data, n);
+	case SimdSSE2:
+		return findPeakSSE2(data, n);
+#endif
+	default:
+		return findPeakReference(data, n);
+	}
+}
+
+void Decibels::convert(double* data, size_t n, double scale, double floor, double dBMult)
+{
+	// dBMult * log10(x) == (dBMult * log10(2)) * log2(x)
+	[[maybe_unused]] const double k = dBMult * log10_2;
+
+	switch (getSimdLevel()) {
+#ifdef SNDSPEC_X86_SIMD
+	case SimdAVX512:
+		return convertAVX512(data, n, scale, floor, k);
+	case SimdAVX2:
+		return convertAVX2(data, n, scale, floor, k);
+	case SimdSSE2:
+		return convertSSE2(data, n, scale, floor, k);
+#endif
+	default:
+		return convertReference(data, n, scale, floor, dBMult);
+	}
+}
+
+double Decibels::findPeakReference(const double* data, size_t n)
+{
+	double peak{0.0};
+	for (size_t i = 0; i < n; i++) {
+		peak = std::max(peak, data[i]);
+	}
+	return peak;
+}
+
+float Decibels::findPeakReference(const float* data, size_t n)
+{
+	float peak{0.0f};
+	for (size_t i = 0; i < n; i++) {
+		peak = std::max(peak, data[i]);
+	}
+	return peak;
+}
+
+void Decibels::convertReference(double* data, size_t n, double scale, double floor, double dBMult)
+{
+	std::transform(data, data + n, data, [scale, dBMult, floor] (double v) -> double {
+		return dBMult * std::log10(std::max(scale * v, floor));
+	});
+}
+
+} // namespace Sndspec
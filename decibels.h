@@ -0,0 +1,57 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef DECIBELS_H
+#define DECIBELS_H
+
+#include <cstddef>
+#include <string>
+
+namespace Sndspec {
+
+// class Decibels : vectorised kernels for peak-finding and dB conversion of large arrays.
+// On x86, the best available instruction set (AVX-512, AVX2 or SSE2) is selected at runtime.
+// The vectorised log uses a polynomial approximation (error < 1e-8 dB);
+// the scalar reference functions (using std::log10) are provided for validation.
+
+class Decibels
+{
+public:
+	enum SimdLevel
+	{
+		SimdNone,
+		SimdSSE2,
+		SimdAVX2,
+		SimdAVX512
+	};
+
+	// findPeak() : returns largest value in data (or zero, if there are no positive values)
+	static double findPeak(const double* data, size_t n);
+	static float findPeak(const float* data, size_t n);
+
+	// convert() : in-place conversion of data[i] into dBMult * log10(max(scale * data[i], floor))
+	// floor must be a positive, normal number
+	static void convert(double* data, size_t n, double scale, double floor, double dBMult);
+
+	// scalar reference implementations
+	static double findPeakReference(const double* data, size_t n);
+	static float findPeakReference(const float* data, size_t n);
+	static void convertReference(double* data, size_t n, double scale, double floor, double dBMult);
+
+	// the kernels in use are determined by the SimdLevel, which defaults to the best level supported by the CPU.
+	// setSimdLevel() can be used to select a lower level (higher levels than the CPU supports are ignored)
+	static SimdLevel getSimdLevel();
+	static void setSimdLevel(SimdLevel level);
+	static SimdLevel getSupportedSimdLevel();
+	static std::string getSimdLevelName(SimdLevel level);
+};
+
+} // namespace Sndspec
+
+#endif // DECIBELS_H
@@ -0,0 +1,120 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include "window.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+namespace Sndspec {
+
+// class Decimator : front-end for band-limited ("zoom") analysis.
+// Shifts a band of a real signal down to 0 Hz (by mixing with a complex oscillator), low-pass filters it,
+// and keeps every factor'th sample. Only the samples which are kept are actually filtered.
+// The low-pass filter is a Kaiser-windowed sinc, which passes the band, and rejects everything which would otherwise alias into it.
+// Input may be supplied in blocks of any size. Frequencies are normalized (ie cycles per sample).
+
+class Decimator
+{
+public:
+	using Complex = std::complex<double>;
+
+	Decimator(int factor, double centerFreq, double bandwidth, double stopbandAttenuation, int64_t maxOutputs)
+		: factor(std::max(1, factor)), centerFreq(centerFreq), maxOutputs(maxOutputs)
+	{
+		if (Decimator::factor == 1) {
+			taps.assign(1, 1.0);
+		} else {
+			// the transition band lies between the edge of the band and the first frequency which would alias into the band
+			const double cutoff = 0.5 / Decimator::factor;
+			const double transition = std::max(1.0 / Decimator::factor - bandwidth, 0.1 / Decimator::factor);
+			const int length = static_cast<int>(std::ceil((stopbandAttenuation - 7.95) / (2.285 * 2.0 * M_PI * transition))) | 1;
+
+			Window<double> window;
+			window.generate("kaiser", std::max(3, length), Window<double>::kaiserBetaFromDecibels(stopbandAttenuation));
+			const std::vector<double>& w = window.getData();
+			const double center = (w.size() - 1) / 2.0;
+			taps.resize(w.size());
+			for (size_t n = 0; n < taps.size(); n++) {
+				const double t = 2.0 * cutoff * (n - center);
+				taps[n] = 2.0 * cutoff * w[n] * ((std::fpclassify(t) == FP_ZERO) ? 1.0 : std::sin(M_PI * t) / (M_PI * t));
+			}
+		}
+		output.reserve(maxOutputs);
+	}
+
+	// process() : mix, filter and decimate count input samples
+	void process(const double* input, int64_t count)
+	{
+		for (int64_t i = 0; i < count; i++) {
+			const double phase = -2.0 * M_PI * std::fmod(centerFreq * static_cast<double>(inputPos++), 1.0);
+			buffer.emplace_back(input[i] * std::cos(phase), input[i] * std::sin(phase));
+		}
+
+		const int64_t numTaps = static_cast<int64_t>(taps.size());
+		while (static_cast<int64_t>(output.size()) < maxOutputs && nextOutputStart + numTaps <= bufferStart + static_cast<int64_t>(buffer.size())) {
+			const Complex* p = buffer.data() + (nextOutputStart - bufferStart);
+			double re = 0.0;
+			double im = 0.0;
+			for (int64_t n = 0; n < numTaps; n++) {
+				re += p[n].real() * taps[n];
+				im += p[n].imag() * taps[n];
+			}
+			output.emplace_back(re, im);
+			nextOutputStart += factor;
+		}
+
+		// discard samples which are no longer needed
+		const int64_t discard = std::min(nextOutputStart - bufferStart, static_cast<int64_t>(buffer.size()));
+		buffer.erase(buffer.begin(), buffer.begin() + discard);
+		bufferStart += discard;
+	}
+
+	const std::vector<Complex>& getOutput() const
+	{
+		return output;
+	}
+
+	int getFactor() const
+	{
+		return factor;
+	}
+
+	int getFilterLength() const
+	{
+		return static_cast<int>(taps.size());
+	}
+
+	// getInputRequired() : number of input samples required to produce maxOutputs outputs
+	int64_t getInputRequired() const
+	{
+		return (maxOutputs - 1) * factor + static_cast<int64_t>(taps.size());
+	}
+
+private:
+	int factor;
+	double centerFreq;
+	int64_t maxOutputs;
+	std::vector<double> taps;
+	std::vector<Complex> buffer; // mixed input samples, beginning at bufferStart
+	std::vector<Complex> output;
+	int64_t inputPos{0};
+	int64_t bufferStart{0};
+	int64_t nextOutputStart{0}; // position of first input sample used for next output
+};
+
+} // namespace Sndspec
+
+#endif // DECIMATOR_H
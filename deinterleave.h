@@ -0,0 +1,183 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef DEINTERLEAVE_H
+#define DEINTERLEAVE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace Sndspec {
+
+// class Deinterleaver : kernels which split interleaved frames into channel buffers, optionally applying a window.
+// The input samples are of type S, which may be an integer type (for PCM data read directly from the file), in which case
+// they are converted to T and scaled in the same pass.
+// The Sum and Difference kernels mix all channels into the first channel buffer instead.
+// There are specialisations for the common channel counts (1, 2, 6 and 8), in which the channel count is a compile-time constant,
+// so that each loop has a fixed stride and a single output, and can be vectorised by the compiler.
+// The frames are processed in tiles, so that the input of each tile is still in cache when the next channel is read from it.
+// Other channel counts use a generic version. The kernel is chosen once (per file), with getKernel().
+
+enum DeinterleaveMode
+{
+	DeinterleaveNormal,
+	DeinterleaveSum,
+	DeinterleaveDifference
+};
+
+template <typename T, typename S = T>
+class Deinterleaver
+{
+public:
+	// Kernel : deinterleave frames [fBegin, fEnd) from p (which points to frame fBegin) into channelBuffers,
+	// multiplying each sample by scale (ignored if S is T), and frame f by window[f] (if window is not nullptr)
+	using Kernel = void (*)(const S* p, T* const* channelBuffers, const T* window, int64_t fBegin, int64_t fEnd, int nChannels, T scale);
+
+	// getKernel() : returns the kernel for the given mode and number of channels
+	static Kernel getKernel(DeinterleaveMode mode, int nChannels)
+	{
+		switch (nChannels) {
+		case 1:
+			return getKernel<1>(mode);
+		case 2:
+			return getKernel<2>(mode);
+		case 6:
+			return getKernel<6>(mode);
+		case 8:
+			return getKernel<8>(mode);
+		default:
+			return getKernel<0>(mode);
+		}
+	}
+
+private:
+	static constexpr int64_t tileSize = 512; // frames
+
+	template <int N>
+	static Kernel getKernel(DeinterleaveMode mode)
+	{
+		switch (mode) {
+		case DeinterleaveSum:
+			return &deinterleaveSum<N>;
+		case DeinterleaveDifference:
+			return &deinterleaveDifference<N>;
+		default:
+			return &deinterleaveNormal<N>;
+		}
+	}
+
+	// (N == 0 : number of channels is only known at runtime)
+
+	// convert() : convert a sample to T
+	static T convert(S sample, T scale)
+	{
+		if constexpr (std::is_same<S, T>::value) {
+			(void)scale;
+			return sample;
+		} else {
+			return static_cast<T>(sample) * scale;
+		}
+	}
+
+	template <int N>
+	static void deinterleaveNormal(const S* p, T* const* channelBuffers, const T* window, int64_t fBegin, int64_t fEnd, int nChannels, T scale)
+	{
+		const int n = (N > 0) ? N : nChannels;
+		for (int64_t t = fBegin; t < fEnd; t += tileSize) {
+			const int64_t count = std::min(tileSize, fEnd - t);
+			for (int ch = 0; ch < n; ch++) {
+				const S* in = p + (t - fBegin) * n + ch;
+				T* out = channelBuffers[ch] + t;
+				if (window == nullptr) {
+					for (int64_t i = 0; i < count; i++) {
+						out[i] = convert(in[i * n], scale);
+					}
+				} else {
+					const T* w = window + t;
+					for (int64_t i = 0; i < count; i++) {
+						out[i] = convert(in[i * n], scale) * w[i];
+					}
+				}
+			}
+		}
+	}
+
+	// sum and difference : the other channel buffers are cleared (once per span, rather than once per frame)
+
+	template <int N>
+	static void deinterleaveSum(const S* p, T* const* channelBuffers, const T* window, int64_t fBegin, int64_t fEnd, int nChannels, T scale)
+	{
+		const int n = (N > 0) ? N : nChannels;
+		const int64_t count = fEnd - fBegin;
+		T* out = channelBuffers[0] + fBegin;
+		if (window == nullptr) {
+			for (int64_t i = 0; i < count; i++) {
+				T sum = convert(p[i * n], scale);
+				for (int ch = 1; ch < n; ch++) {
+					sum += convert(p[i * n + ch], scale);
+				}
+				out[i] = sum;
+			}
+		} else {
+			const T* w = window + fBegin;
+			for (int64_t i = 0; i < count; i++) {
+				T sum = convert(p[i * n], scale);
+				for (int ch = 1; ch < n; ch++) {
+					sum += convert(p[i * n + ch], scale);
+				}
+				out[i] = sum * w[i];
+			}
+		}
+		clearOthers(channelBuffers, fBegin, count, n);
+	}
+
+	template <int N>
+	static void deinterleaveDifference(const S* p, T* const* channelBuffers, const T* window, int64_t fBegin, int64_t fEnd, int nChannels, T scale)
+	{
+		const int n = (N > 0) ? N : nChannels;
+		const int64_t count = fEnd - fBegin;
+		T* out = channelBuffers[0] + fBegin;
+		if (window == nullptr) {
+			for (int64_t i = 0; i < count; i++) {
+				T diff = convert(p[i * n], scale);
+				for (int ch = 1; ch < n; ch++) {
+					diff -= convert(p[i * n + ch], scale);
+				}
+				out[i] = diff;
+			}
+		} else {
+			const T* w = window + fBegin;
+			for (int64_t i = 0; i < count; i++) {
+				T diff = convert(p[i * n], scale);
+				for (int ch = 1; ch < n; ch++) {
+					diff -= convert(p[i * n + ch], scale);
+				}
+				out[i] = diff * w[i];
+			}
+		}
+		clearOthers(channelBuffers, fBegin, count, n);
+	}
+
+	static void clearOthers(T* const* channelBuffers, int64_t fBegin, int64_t count, int nChannels)
+	{
+		for (int ch = 1; ch < nChannels; ch++) {
+			if (channelBuffers[ch] != nullptr) {
+				T* out = channelBuffers[ch] + fBegin;
+				for (int64_t i = 0; i < count; i++) {
+					out[i] = 0.0;
+				}
+			}
+		}
+	}
+};
+
+} // namespace Sndspec
+
+#endif // DEINTERLEAVE_H
@@ -0,0 +1,208 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef FFTWTRAITS_H
+#define FFTWTRAITS_H
+
+#include <fftw3.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+
+namespace Sndspec {
+
+// getPlannerMutex() : the fftw planner is not thread-safe (only fftw_execute() is), so plan creation / destruction must be serialized
+inline std::mutex& getPlannerMutex()
+{
+	static std::mutex plannerMutex;
+	return plannerMutex;
+}
+
+// getPlannerEffort() : planner rigor flag (FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT or FFTW_EXHAUSTIVE) used for all plans
+inline std::atomic<unsigned>& getPlannerEffort()
+{
+	static std::atomic<unsigned> plannerEffort{FFTW_MEASURE};
+	return plannerEffort;
+}
+
+// FFTW<FloatType> : maps the fftw API onto the double-precision (fftw_) or single-precision (fftwf_) library
+
+template <typename FloatType>
+struct FFTW;
+
+template <>
+struct FFTW<double>
+{
+	using Complex = fftw_complex;
+	using Plan = fftw_plan;
+
+	static double* allocReal(size_t n)
+	{
+		return fftw_alloc_real(n);
+	}
+
+	static Complex* allocComplex(size_t n)
+	{
+		return fftw_alloc_complex(n);
+	}
+
+	static void free(void* p)
+	{
+		fftw_free(p);
+	}
+
+	static Plan planR2C(int n, double* in, Complex* out, unsigned flags)
+	{
+		return fftw_plan_dft_r2c_1d(n, in, out, flags);
+	}
+
+	static Plan planManyR2C(int n, int howMany, double* in, int inDist, Complex* out, int outDist, unsigned flags)
+	{
+		return fftw_plan_many_dft_r2c(1, &n, howMany, in, nullptr, 1, inDist, out, nullptr, 1, outDist, flags);
+	}
+
+	// planManyDFT() : complex-to-complex transforms of howMany contiguous arrays, dist elements apart
+	static Plan planManyDFT(int n, int howMany, Complex* in, Complex* out, int dist, int sign, unsigned flags)
+	{
+		return fftw_plan_many_dft(1, &n, howMany, in, nullptr, 1, dist, out, nullptr, 1, dist, sign, flags);
+	}
+
+	static void execute(const Plan plan)
+	{
+		fftw_execute(plan);
+	}
+
+	// executeR2C() : execute plan on the given arrays (which must have the same alignment as the arrays used for planning)
+	static void executeR2C(const Plan plan, double* in, Complex* out)
+	{
+		fftw_execute_dft_r2c(plan, in, out);
+	}
+
+	// executeDFT() : execute complex-to-complex plan on the given arrays
+	static void executeDFT(const Plan plan, Complex* in, Complex* out)
+	{
+		fftw_execute_dft(plan, in, out);
+	}
+
+	static void destroyPlan(Plan plan)
+	{
+		fftw_destroy_plan(plan);
+	}
+
+	static bool importWisdom(const char* filename)
+	{
+		return fftw_import_wisdom_from_filename(filename) != 0;
+	}
+
+	static bool exportWisdom(const char* filename)
+	{
+		return fftw_export_wisdom_to_filename(filename) != 0;
+	}
+
+	// exportWisdomToString() : returns the accumulated wisdom (or an empty string on failure)
+	static std::string exportWisdomToString()
+	{
+		char* s = fftw_export_wisdom_to_string();
+		if (s == nullptr) {
+			return {};
+		}
+		const std::string wisdom{s};
+		std::free(s);
+		return wisdom;
+	}
+};
+
+template <>
+struct FFTW<float>
+{
+	using Complex = fftwf_complex;
+	using Plan = fftwf_plan;
+
+	static float* allocReal(size_t n)
+	{
+		return fftwf_alloc_real(n);
+	}
+
+	static Complex* allocComplex(size_t n)
+	{
+		return fftwf_alloc_complex(n);
+	}
+
+	static void free(void* p)
+	{
+		fftwf_free(p);
+	}
+
+	static Plan planR2C(int n, float* in, Complex* out, unsigned flags)
+	{
+		return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+	}
+
+	static Plan planManyR2C(int n, int howMany, float* in, int inDist, Complex* out, int outDist, unsigned flags)
+	{
+		return fftwf_plan_many_dft_r2c(1, &n, howMany, in, nullptr, 1, inDist, out, nullptr, 1, outDist, flags);
+	}
+
+	// planManyDFT() : complex-to-complex transforms of howMany contiguous arrays, dist elements apart
+	static Plan planManyDFT(int n, int howMany, Complex* in, Complex* out, int dist, int sign, unsigned flags)
+	{
+		return fftwf_plan_many_dft(1, &n, howMany, in, nullptr, 1, dist, out, nullptr, 1, dist, sign, flags);
+	}
+
+	static void execute(const Plan plan)
+	{
+		fftwf_execute(plan);
+	}
+
+	// executeR2C() : execute plan on the given arrays (which must have the same alignment as the arrays used for planning)
+	static void executeR2C(const Plan plan, float* in, Complex* out)
+	{
+		fftwf_execute_dft_r2c(plan, in, out);
+	}
+
+	// executeDFT() : execute complex-to-complex plan on the given arrays
+	static void executeDFT(const Plan plan, Complex* in, Complex* out)
+	{
+		fftwf_execute_dft(plan, in, out);
+	}
+
+	static void destroyPlan(Plan plan)
+	{
+		fftwf_destroy_plan(plan);
+	}
+
+	static bool importWisdom(const char* filename)
+	{
+		return fftwf_import_wisdom_from_filename(filename) != 0;
+	}
+
+	static bool exportWisdom(const char* filename)
+	{
+		return fftwf_export_wisdom_to_filename(filename) != 0;
+	}
+
+	// exportWisdomToString() : returns the accumulated wisdom (or an empty string on failure)
+	static std::string exportWisdomToString()
+	{
+		char* s = fftwf_export_wisdom_to_string();
+		if (s == nullptr) {
+			return {};
+		}
+		const std::string wisdom{s};
+		std::free(s);
+		return wisdom;
+	}
+};
+
+} // namespace Sndspec
+
+#endif // FFTWTRAITS_H
@@ -13,6 +13,7 @@
 #include "spectrum.h"
 #include "tests.h"
 #include "window.h"
+#include "wisdom.h"
 
 #include <sndfile.hh>
 #include <cstring>
@@ -29,6 +30,20 @@ int main(int argc, char** argv)
 		exit(0);
 	}
 
+	// load previously-measured FFT plans
+	Sndspec::Wisdom::setPlanEffort(parameters.getPlanEffort());
+	Sndspec::Wisdom::load();
+
+	if (parameters.getWarmWisdom()) {
+		Sndspec::Wisdom::warm(parameters, std::cout);
+		if (Sndspec::Wisdom::save()) {
+			std::cout << "Wisdom saved to " << Sndspec::Wisdom::getDirectory() << std::endl;
+		} else {
+			std::cout << "Error: couldn't save wisdom" << std::endl;
+		}
+		return 0;
+	}
+
 	if (parameters.getPlotWindowFunction()) {
 		if (parameters.getWindowFunction().compare("all") == 0) {
 			Sndspec::Spectrum::plotAllWindows(parameters.plotTimeDomain(), parameters.hasWhiteBackground());
@@ -41,5 +56,8 @@ int main(int argc, char** argv)
 		Sndspec::Spectrogram::makeSpectrogramFromFile(parameters);
 	}
 
+	// keep any newly-measured plans for next time
+	Sndspec::Wisdom::save();
+
 	return 0;
 }
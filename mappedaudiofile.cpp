@@ -0,0 +1,320 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "mappedaudiofile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Sndspec {
+
+namespace {
+
+uint16_t readLE16(const unsigned char* p)
+{
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLE32(const unsigned char* p)
+{
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t readLE64(const unsigned char* p)
+{
+	return static_cast<uint64_t>(readLE32(p)) | (static_cast<uint64_t>(readLE32(p + 4)) << 32);
+}
+
+uint16_t readBE16(const unsigned char* p)
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t readBE32(const unsigned char* p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+bool isId(const unsigned char* p, const char* id)
+{
+	return std::memcmp(p, id, 4) == 0;
+}
+
+bool isLittleEndianHost()
+{
+	const uint16_t one{1};
+	unsigned char b;
+	std::memcpy(&b, &one, 1);
+	return b == 1;
+}
+
+// Wave64 GUIDs
+const unsigned char w64Riff[16] = {0x72, 0x69, 0x66, 0x66, 0x2e, 0x91, 0xcf, 0x11, 0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00};
+const unsigned char w64Wave[16] = {0x77, 0x61, 0x76, 0x65, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a};
+const unsigned char w64Fmt[16] = {0x66, 0x6d, 0x74, 0x20, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a};
+const unsigned char w64Data[16] = {0x64, 0x61, 0x74, 0x61, 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a};
+
+constexpr uint16_t waveFormatPcm = 0x0001;
+constexpr uint16_t waveFormatFloat = 0x0003;
+constexpr uint16_t waveFormatExtensible = 0xfffe;
+
+// wave format chunk (as used by WAV, RF64 and Wave64)
+struct WaveFormat
+{
+	uint16_t formatTag{0};
+	int channels{0};
+	int samplerate{0};
+	int blockAlign{0};
+	int bits{0};
+};
+
+bool parseWaveFormat(const unsigned char* p, uint64_t size, WaveFormat& fmt)
+{
+	if (size < 16) {
+		return false;
+	}
+	fmt.formatTag = readLE16(p);
+	fmt.channels = readLE16(p + 2);
+	fmt.samplerate = static_cast<int>(readLE32(p + 4));
+	fmt.blockAlign = readLE16(p + 12);
+	fmt.bits = readLE16(p + 14);
+	if (fmt.formatTag == waveFormatExtensible) {
+		if (size < 40) {
+			return false;
+		}
+		fmt.formatTag = readLE16(p + 24); // (first two bytes of the SubFormat GUID)
+	}
+	return true;
+}
+
+} // namespace
+
+bool MappedAudioFile::open(const std::string &filename)
+{
+	close();
+
+	// (the sample data is only read directly from the mapping when the byte order of the host is little-endian)
+	if (!isLittleEndianHost() || !file.open(filename)) {
+		return false;
+	}
+
+	const unsigned char* p = static_cast<const unsigned char*>(file.getData());
+	const size_t size = file.getSize();
+	bool ok{false};
+	if (size >= 12 && (isId(p, "RIFF") || isId(p, "RF64") || isId(p, "BW64")) && isId(p + 8, "WAVE")) {
+		ok = parseWave(p, size);
+	} else if (size >= 40 && std::memcmp(p, w64Riff, 16) == 0 && std::memcmp(p + 24, w64Wave, 16) == 0) {
+		ok = parseWave64(p, size);
+	} else if (size >= 12 && isId(p, "FORM") && (isId(p + 8, "AIFF") || isId(p + 8, "AIFC"))) {
+		ok = parseAiff(p, size);
+	}
+
+	if (!ok) {
+		close();
+	}
+	return ok;
+}
+
+void MappedAudioFile::close()
+{
+	file.close();
+	frames = nullptr;
+	encoding = EncodingUnsupported;
+	channels = 0;
+	samplerate = 0;
+	nFrames = 0;
+	frameBytes = 0;
+}
+
+void MappedAudioFile::advise(int64_t startFrame, int64_t count, MappedFile::Advice advice)
+{
+	startFrame = std::max(INT64_C(0), startFrame);
+	count = std::min(count, nFrames - startFrame);
+	if (frames == nullptr || count <= 0) {
+		return;
+	}
+	const size_t offset = static_cast<size_t>(frames - static_cast<const unsigned char*>(file.getData()));
+	file.advise(offset + static_cast<size_t>(startFrame * frameBytes), static_cast<size_t>(count * frameBytes), advice);
+}
+
+bool MappedAudioFile::parseWave(const unsigned char *p, size_t size)
+{
+	const bool isRf64 = !isId(p, "RIFF");
+	uint64_t ds64DataSize{0};
+	WaveFormat fmt;
+	bool hasFormat{false};
+
+	for (uint64_t pos = 12; pos + 8 <= size;) {
+		const unsigned char* chunk = p + pos;
+		const uint64_t chunkSize = readLE32(chunk + 4);
+		const unsigned char* body = chunk + 8;
+		const uint64_t available = size - pos - 8;
+
+		if (isId(chunk, "ds64")) {
+			if (chunkSize < 24 || available < 24) {
+				return false;
+			}
+			ds64DataSize = readLE64(body + 8);
+		} else if (isId(chunk, "fmt ")) {
+			if (!parseWaveFormat(body, std::min(chunkSize, available), fmt)) {
+				return false;
+			}
+			hasFormat = true;
+		} else if (isId(chunk, "data")) {
+			if (!hasFormat) {
+				return false;
+			}
+			const uint64_t dataSize = (isRf64 && chunkSize == 0xffffffff) ? ds64DataSize : chunkSize;
+			if (fmt.formatTag != waveFormatPcm && fmt.formatTag != waveFormatFloat) {
+				return false;
+			}
+			channels = fmt.channels;
+			samplerate = fmt.samplerate;
+			return setFormat(fmt.bits, fmt.formatTag == waveFormatFloat, false, fmt.blockAlign, pos + 8, dataSize);
+		}
+
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	return false;
+}
+
+bool MappedAudioFile::parseWave64(const unsigned char *p, size_t size)
+{
+	WaveFormat fmt;
+	bool hasFormat{false};
+
+	// each chunk : 16-byte GUID, 64-bit size (which includes the 24-byte chunk header), and is aligned to 8 bytes
+	for (uint64_t pos = 40; pos + 24 <= size;) {
+		const unsigned char* chunk = p + pos;
+		const uint64_t chunkSize = readLE64(chunk + 16);
+		if (chunkSize < 24) {
+			return false;
+		}
+		const unsigned char* body = chunk + 24;
+		const uint64_t available = size - pos - 24;
+
+		if (std::memcmp(chunk, w64Fmt, 16) == 0) {
+			if (!parseWaveFormat(body, std::min(chunkSize - 24, available), fmt)) {
+				return false;
+			}
+			hasFormat = true;
+		} else if (std::memcmp(chunk, w64Data, 16) == 0) {
+			if (!hasFormat || (fmt.formatTag != waveFormatPcm && fmt.formatTag != waveFormatFloat)) {
+				return false;
+			}
+			channels = fmt.channels;
+			samplerate = fmt.samplerate;
+			return setFormat(fmt.bits, fmt.formatTag == waveFormatFloat, false, fmt.blockAlign, pos + 24, chunkSize - 24);
+		}
+
+		pos += (chunkSize + 7) & ~UINT64_C(7);
+	}
+
+	return false;
+}
+
+bool MappedAudioFile::parseAiff(const unsigned char *p, size_t size)
+{
+	const bool isAifc = isId(p + 8, "AIFC");
+	int bits{0};
+	bool bigEndian{true};
+	bool hasFormat{false};
+
+	for (uint64_t pos = 12; pos + 8 <= size;) {
+		const unsigned char* chunk = p + pos;
+		const uint64_t chunkSize = readBE32(chunk + 4);
+		const unsigned char* body = chunk + 8;
+		const uint64_t available = size - pos - 8;
+
+		if (isId(chunk, "COMM")) {
+			if (chunkSize < 18 || available < 18 || (isAifc && (chunkSize < 22 || available < 22))) {
+				return false;
+			}
+			channels = readBE16(body);
+			bits = readBE16(body + 6);
+
+			// sample rate is an 80-bit IEEE 754 extended-precision number
+			const int exponent = readBE16(body + 8) & 0x7fff;
+			const uint64_t mantissa = (static_cast<uint64_t>(readBE32(body + 10)) << 32) | readBE32(body + 14);
+			samplerate = static_cast<int>(std::lround(std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63)));
+
+			if (isAifc) {
+				// only uncompressed integer encodings are supported
+				if (isId(body + 18, "sowt")) {
+					bigEndian = false;
+				} else if (!(isId(body + 18, "NONE") || isId(body + 18, "twos") || isId(body + 18, "in24") || isId(body + 18, "in32"))) {
+					return false;
+				}
+			}
+			hasFormat = true;
+		} else if (isId(chunk, "SSND")) {
+			if (!hasFormat || chunkSize < 8 || available < 8) {
+				return false;
+			}
+			const uint64_t offset = readBE32(body);
+			if (offset > chunkSize - 8) {
+				return false;
+			}
+			const int bytes = (bits + 7) / 8;
+			return setFormat(bits, false, bigEndian, bytes * channels, pos + 16 + offset, chunkSize - 8 - offset);
+		}
+
+		pos += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	return false;
+}
+
+bool MappedAudioFile::setFormat(int bits, bool isFloat, bool bigEndian, int blockAlign, uint64_t dataOffset, uint64_t dataSize)
+{
+	const int bytes = (bits + 7) / 8;
+	if (channels <= 0 || samplerate <= 0 || blockAlign != bytes * channels || dataOffset > file.getSize()) {
+		return false;
+	}
+
+	if (isFloat) {
+		if (bigEndian) {
+			encoding = EncodingUnsupported;
+		} else {
+			encoding = (bytes == 4) ? EncodingFloat : (bytes == 8) ? EncodingDouble : EncodingUnsupported;
+		}
+	} else {
+		switch (bytes) {
+		case 2:
+			encoding = bigEndian ? EncodingInt16BE : EncodingInt16;
+			break;
+		case 3:
+			encoding = bigEndian ? EncodingInt24BE : EncodingInt24;
+			break;
+		case 4:
+			encoding = bigEndian ? EncodingInt32BE : EncodingInt32;
+			break;
+		default:
+			encoding = EncodingUnsupported; // (8-bit is left to libsndfile)
+		}
+	}
+
+	// samples of native types are accessed directly, and must be aligned
+	const bool native = (encoding == EncodingInt16 || encoding == EncodingInt32 || encoding == EncodingFloat || encoding == EncodingDouble);
+	if (encoding == EncodingUnsupported || (native && dataOffset % static_cast<uint64_t>(bytes) != 0)) {
+		encoding = EncodingUnsupported;
+		return false;
+	}
+
+	// (the data chunk of a file which is still being written, or was truncated, may extend past the end of the file)
+	dataSize = std::min(dataSize, file.getSize() - dataOffset);
+	frames = static_cast<const unsigned char*>(file.getData()) + dataOffset;
+	frameBytes = blockAlign;
+	nFrames = static_cast<int64_t>(dataSize / static_cast<uint64_t>(blockAlign));
+	return true;
+}
+
+} // namespace Sndspec
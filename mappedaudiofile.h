@@ -0,0 +1,121 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef MAPPEDAUDIOFILE_H
+#define MAPPEDAUDIOFILE_H
+
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Sndspec {
+
+// PackedSample<Bytes, BigEndian> : an integer PCM sample, exactly as stored in the file (with no alignment).
+// Converting it to int32_t gives the sample value, left-justified in 32 bits
+template <int Bytes, bool BigEndian>
+struct PackedSample
+{
+	unsigned char b[Bytes];
+
+	operator int32_t() const
+	{
+		uint32_t v{0};
+		for (int i = 0; i < Bytes; i++) {
+			v |= static_cast<uint32_t>(b[BigEndian ? i : Bytes - 1 - i]) << (24 - 8 * i);
+		}
+		return static_cast<int32_t>(v);
+	}
+};
+
+using PackedInt24 = PackedSample<3, false>;
+using PackedInt16BE = PackedSample<2, true>;
+using PackedInt24BE = PackedSample<3, true>;
+using PackedInt32BE = PackedSample<4, true>;
+
+// class MappedAudioFile : maps an uncompressed audio file (WAV, RF64 / BW64, Wave64 or AIFF / AIFC) into memory,
+// so that the sample data can be read directly from the mapping, without any copying.
+// The headers are parsed here; open() fails for any other kind of file, or for any encoding which isn't supported,
+// in which case the file can be read with libsndfile instead.
+
+class MappedAudioFile
+{
+public:
+	enum Encoding
+	{
+		EncodingUnsupported,
+		EncodingInt16, // native (little-endian) short
+		EncodingInt32, // native int
+		EncodingFloat, // native float
+		EncodingDouble, // native double
+		EncodingInt24, // PackedInt24
+		EncodingInt16BE, // PackedInt16BE
+		EncodingInt24BE, // PackedInt24BE
+		EncodingInt32BE // PackedInt32BE
+	};
+
+	// open() : map the file and parse its header. Returns true if the file can be read from the mapping
+	bool open(const std::string& filename);
+
+	void close();
+
+	// getFrames() : address of the first frame of interleaved sample data
+	const void* getFrames() const
+	{
+		return frames;
+	}
+
+	Encoding getEncoding() const
+	{
+		return encoding;
+	}
+
+	int getChannels() const
+	{
+		return channels;
+	}
+
+	int getSamplerate() const
+	{
+		return samplerate;
+	}
+
+	int64_t getNFrames() const
+	{
+		return nFrames;
+	}
+
+	// getFrameBytes() : size of one frame (in bytes)
+	int getFrameBytes() const
+	{
+		return frameBytes;
+	}
+
+	// advise() : hint about how the given range of frames will be accessed
+	void advise(int64_t startFrame, int64_t count, MappedFile::Advice advice);
+
+private:
+	MappedFile file;
+	const unsigned char* frames{nullptr};
+	Encoding encoding{EncodingUnsupported};
+	int channels{0};
+	int samplerate{0};
+	int64_t nFrames{0};
+	int frameBytes{0};
+
+	bool parseWave(const unsigned char* p, size_t size);
+	bool parseWave64(const unsigned char* p, size_t size);
+	bool parseAiff(const unsigned char* p, size_t size);
+	bool setFormat(int bits, bool isFloat, bool bigEndian, int blockAlign, uint64_t dataOffset, uint64_t dataSize);
+};
+
+} // namespace Sndspec
+
+#endif // MAPPEDAUDIOFILE_H
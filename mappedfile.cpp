@@ -0,0 +1,270 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Sndspec {
+
+namespace fs = std::filesystem;
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::create(const std::string &directory, size_t size)
+{
+	close();
+
+	char filename[MAX_PATH];
+	if (GetTempFileNameA(directory.c_str(), "ssp", 0, filename) == 0) {
+		return false;
+	}
+
+	HANDLE f = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+						   FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+	if (f == INVALID_HANDLE_VALUE) {
+		DeleteFileA(filename);
+		return false;
+	}
+	fileHandle = f;
+
+	LARGE_INTEGER li;
+	li.QuadPart = static_cast<LONGLONG>(size);
+	if (!SetFilePointerEx(f, li, nullptr, FILE_BEGIN) || !SetEndOfFile(f)) {
+		close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(f, nullptr, PAGE_READWRITE, li.HighPart, li.LowPart, nullptr);
+	if (mappingHandle == nullptr) {
+		close();
+		return false;
+	}
+
+	data = MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+
+	MappedFile::size = size;
+	return true;
+}
+
+bool MappedFile::open(const std::string &filename)
+{
+	close();
+
+	HANDLE f = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (f == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	fileHandle = f;
+
+	LARGE_INTEGER li;
+	if (!GetFileSizeEx(f, &li) || li.QuadPart == 0) {
+		close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr) {
+		close();
+		return false;
+	}
+
+	data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+
+	size = static_cast<size_t>(li.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle); // (FILE_FLAG_DELETE_ON_CLOSE)
+		fileHandle = nullptr;
+	}
+
+	size = 0;
+}
+
+void MappedFile::release(size_t offset, size_t length)
+{
+	if (data == nullptr || offset >= size) {
+		return;
+	}
+
+	// unlocking pages which aren't locked removes them from the working set
+	VirtualUnlock(static_cast<char*>(data) + offset, std::min(length, size - offset));
+}
+
+void MappedFile::advise(size_t offset, size_t length, Advice advice)
+{
+	// (FILE_FLAG_SEQUENTIAL_SCAN already applies to the whole file, and PrefetchVirtualMemory() isn't available on all versions of Windows)
+	(void)offset;
+	(void)length;
+	(void)advice;
+}
+
+#else
+
+bool MappedFile::create(const std::string &directory, size_t size)
+{
+	close();
+
+	std::string pattern = (fs::path(directory) / "sndspec-XXXXXX").string();
+	std::vector<char> filename(pattern.begin(), pattern.end());
+	filename.push_back('\0');
+
+	fd = mkstemp(filename.data());
+	if (fd == -1) {
+		return false;
+	}
+
+	unlink(filename.data()); // the file disappears as soon as it is closed
+
+	// reserve the space now, rather than making a sparse file: if the filesystem filled up part-way through a transform,
+	// the next write to the mapping would raise SIGBUS, instead of failing here with an error
+#ifdef __APPLE__
+	// (macOS has no posix_fallocate())
+	fstore_t store{F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(size), 0};
+	if (fcntl(fd, F_PREALLOCATE, &store) == -1 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+		close();
+		return false;
+	}
+#else
+	// (posix_fallocate() returns an error number, rather than setting errno)
+	if (posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0) {
+		close();
+		return false;
+	}
+#endif
+
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		close();
+		return false;
+	}
+
+	data = p;
+	MappedFile::size = size;
+	return true;
+}
+
+bool MappedFile::open(const std::string &filename)
+{
+	close();
+
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	const off_t fileSize = lseek(fd, 0, SEEK_END);
+	if (fileSize <= 0) {
+		close();
+		return false;
+	}
+
+	void* p = mmap(nullptr, static_cast<size_t>(fileSize), PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		close();
+		return false;
+	}
+
+	data = p;
+	size = static_cast<size_t>(fileSize);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != nullptr) {
+		munmap(data, size);
+		data = nullptr;
+	}
+
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+
+	size = 0;
+}
+
+void MappedFile::release(size_t offset, size_t length)
+{
+	if (data == nullptr || offset >= size) {
+		return;
+	}
+
+	// madvise() requires a page-aligned address
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t begin = offset / pageSize * pageSize;
+	const size_t end = std::min(size, offset + length);
+
+	// for a shared file mapping, dirty pages are written back to the file, rather than discarded
+	madvise(static_cast<char*>(data) + begin, end - begin, MADV_DONTNEED);
+}
+
+void MappedFile::advise(size_t offset, size_t length, Advice advice)
+{
+	if (data == nullptr || offset >= size) {
+		return;
+	}
+
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t begin = offset / pageSize * pageSize;
+	const size_t end = std::min(size, offset + length);
+
+	int a = MADV_NORMAL;
+	if (advice == AdviceSequential) {
+		a = MADV_SEQUENTIAL;
+	} else if (advice == AdviceWillNeed) {
+		a = MADV_WILLNEED;
+	}
+
+	madvise(static_cast<char*>(data) + begin, end - begin, a);
+}
+
+#endif
+
+} // namespace Sndspec
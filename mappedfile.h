@@ -0,0 +1,86 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Sndspec {
+
+// class MappedFile : a file, mapped into memory.
+// The operating system pages the contents of the file in and out of memory as required,
+// so the file may be much larger than the available RAM.
+// A file made with create() is a temporary scratch file, which is deleted when it is closed (or when the program exits).
+// A file opened with open() is an existing file, which is mapped read-only.
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// create() : create a scratch file of the given size (in bytes) in the given directory, and map it.
+	// The space for the file is reserved in advance. Returns true on success (false if eg there isn't enough space for it)
+	bool create(const std::string& directory, size_t size);
+
+	// open() : map an existing file (read-only). Returns true on success
+	bool open(const std::string& filename);
+
+	// close() : unmap the file (and delete it, if it is a scratch file)
+	void close();
+
+	void* getData() const
+	{
+		return data;
+	}
+
+	size_t getSize() const
+	{
+		return size;
+	}
+
+	// release() : remove the pages of the given range from memory (the contents are retained in the file)
+	void release(size_t offset, size_t length);
+
+	// release() : remove all pages from memory
+	void release()
+	{
+		release(0, size);
+	}
+
+	enum Advice
+	{
+		AdviceNormal,
+		AdviceSequential, // the range will be read in order, and can be dropped from memory soon after it has been read
+		AdviceWillNeed // the range will be read soon, and should be paged in ahead of time
+	};
+
+	// advise() : tell the operating system how the given range will be accessed (this is only a hint)
+	void advise(size_t offset, size_t length, Advice advice);
+
+private:
+	void* data{nullptr};
+	size_t size{0};
+
+#ifdef _WIN32
+	void* fileHandle{nullptr};
+	void* mappingHandle{nullptr};
+#else
+	int fd{-1};
+#endif
+};
+
+} // namespace Sndspec
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,203 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "outofcorefft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <mutex>
+
+namespace Sndspec {
+
+OutOfCoreFFT::~OutOfCoreFFT()
+{
+	close();
+}
+
+bool OutOfCoreFFT::init(int64_t fftSize, size_t ramBudget, const std::string &scratchDirectory)
+{
+	close();
+
+	if (fftSize < 4 || fftSize % 2 != 0) {
+		return false;
+	}
+
+	// factorize M into rows x columns, as close to square as possible
+	const int64_t m = fftSize / 2;
+	m1 = static_cast<int64_t>(std::sqrt(static_cast<double>(m)));
+	while (m % m1 != 0) {
+		m1--;
+	}
+	m2 = m / m1;
+
+	// half of the budget is for the panel buffer, and the other half is for mapped pages
+	const size_t panelBytes = std::max(size_t{1} << 20, ramBudget / 2);
+	columnsPerPanel = std::clamp(static_cast<int64_t>(panelBytes / (sizeof(Complex) * m1)), INT64_C(1), m2);
+	rowsPerPanel = std::clamp(static_cast<int64_t>(panelBytes / (sizeof(Complex) * m2)), INT64_C(1), m1);
+
+	const size_t fileSize = static_cast<size_t>(m) * sizeof(Complex);
+	if (!input.create(scratchDirectory, fileSize) || !output.create(scratchDirectory, fileSize)) {
+		close();
+		return false;
+	}
+
+	buf = FFTW<double>::allocComplex(static_cast<size_t>(std::max(columnsPerPanel * m1, rowsPerPanel * m2)));
+	if (buf == nullptr) {
+		close();
+		return false;
+	}
+
+	OutOfCoreFFT::fftSize = fftSize;
+	return true;
+}
+
+void OutOfCoreFFT::writeInput(int64_t pos, const double *data, int64_t count)
+{
+	count = std::min(count, fftSize - pos);
+	if (count <= 0) {
+		return;
+	}
+
+	// (the real input is the interleaved real and imaginary parts of the complex sequence)
+	double* dst = static_cast<double*>(input.getData()) + pos;
+	std::memcpy(dst, data, static_cast<size_t>(count) * sizeof(double));
+	input.release(static_cast<size_t>(pos) * sizeof(double), static_cast<size_t>(count) * sizeof(double));
+}
+
+void OutOfCoreFFT::exec()
+{
+	Complex* a = static_cast<Complex*>(input.getData());
+	Complex* b = static_cast<Complex*>(output.getData());
+	const int64_t m = m1 * m2;
+	const double twoPiOverM = 2.0 * M_PI / static_cast<double>(m);
+
+	// steps 1 & 2 : FFT the columns, and multiply by twiddle factors (in place)
+	for (int64_t c0 = 0; c0 < m2; c0 += columnsPerPanel) {
+		const int64_t nc = std::min(columnsPerPanel, m2 - c0);
+		FFTW<double>::Plan plan = getPlan(static_cast<int>(m1), static_cast<int>(nc));
+
+		// gather (each column becomes contiguous in buf)
+		for (int64_t n1 = 0; n1 < m1; n1++) {
+			const Complex* src = a + n1 * m2 + c0;
+			for (int64_t c = 0; c < nc; c++) {
+				buf[c * m1 + n1][0] = src[c][0];
+				buf[c * m1 + n1][1] = src[c][1];
+			}
+		}
+
+		FFTW<double>::executeDFT(plan, buf, buf);
+
+		// twiddle and scatter
+		for (int64_t k1 = 0; k1 < m1; k1++) {
+			Complex* dst = a + k1 * m2 + c0;
+			for (int64_t c = 0; c < nc; c++) {
+				const std::complex<double> w = std::polar(1.0, -twoPiOverM * static_cast<double>((c0 + c) * k1));
+				const std::complex<double> y = std::complex<double>(buf[c * m1 + k1][0], buf[c * m1 + k1][1]) * w;
+				dst[c][0] = y.real();
+				dst[c][1] = y.imag();
+			}
+		}
+
+		input.release();
+	}
+
+	// steps 3 & 4 : FFT the rows, and transpose into output
+	for (int64_t r0 = 0; r0 < m1; r0 += rowsPerPanel) {
+		const int64_t nr = std::min(rowsPerPanel, m1 - r0);
+		FFTW<double>::Plan plan = getPlan(static_cast<int>(m2), static_cast<int>(nr));
+
+		std::memcpy(buf, a + r0 * m2, static_cast<size_t>(nr * m2) * sizeof(Complex));
+		FFTW<double>::executeDFT(plan, buf, buf);
+
+		// the result for row k1, column k2 is element k1 + m1 * k2 of the transform
+		for (int64_t k2 = 0; k2 < m2; k2++) {
+			Complex* dst = b + k2 * m1 + r0;
+			for (int64_t r = 0; r < nr; r++) {
+				dst[r][0] = buf[r * m2 + k2][0];
+				dst[r][1] = buf[r * m2 + k2][1];
+			}
+		}
+
+		input.release(static_cast<size_t>(r0 * m2) * sizeof(Complex), static_cast<size_t>(nr * m2) * sizeof(Complex));
+		output.release();
+	}
+}
+
+void OutOfCoreFFT::calcMagSquared(std::vector<double> &results)
+{
+	if (results.empty()) {
+		return;
+	}
+
+	std::fill(results.begin(), results.end(), 0.0);
+	const Complex* z = static_cast<const Complex*>(output.getData());
+	const int64_t m = m1 * m2;
+	const int64_t groupSize = (getSpectrumSize() + static_cast<int64_t>(results.size()) - 1) / static_cast<int64_t>(results.size());
+	const double piOverM = M_PI / static_cast<double>(m);
+
+	// X[k] = E[k] + exp(-i.pi.k / M) * O[k], where E and O are the spectra of the even and odd input samples:
+	// E[k] = (Z[k] + conj(Z[M - k])) / 2,  O[k] = (Z[k] - conj(Z[M - k])) / 2i
+	auto calcBin = [z, m, piOverM](int64_t k) -> double {
+		const std::complex<double> zk(z[k % m][0], z[k % m][1]);
+		const std::complex<double> zc(z[(m - k) % m][0], -z[(m - k) % m][1]);
+		const std::complex<double> e = 0.5 * (zk + zc);
+		const std::complex<double> o = std::complex<double>(0.0, -0.5) * (zk - zc);
+		return std::norm(e + std::polar(1.0, -piOverM * static_cast<double>(k)) * o);
+	};
+
+	// Z[k] and Z[M - k] are read from opposite ends of the file; release both ends after each panel
+	const int64_t panelSize = std::max(INT64_C(1), columnsPerPanel * m1);
+	for (int64_t k0 = 0; k0 <= m; k0 += panelSize) {
+		const int64_t k1 = std::min(m + 1, k0 + panelSize);
+		for (int64_t k = k0; k < k1; k++) {
+			double& r = results[static_cast<size_t>(k / groupSize)];
+			r = std::max(r, calcBin(k));
+		}
+		output.release(static_cast<size_t>(k0) * sizeof(Complex), static_cast<size_t>(k1 - k0) * sizeof(Complex));
+		output.release(static_cast<size_t>(std::max(INT64_C(0), m - k1)) * sizeof(Complex), static_cast<size_t>(k1 - k0 + 1) * sizeof(Complex));
+	}
+}
+
+FFTW<double>::Plan OutOfCoreFFT::getPlan(int n, int howMany)
+{
+	auto it = plans.find({n, howMany});
+	if (it != plans.end()) {
+		return it->second;
+	}
+
+	// (planning may overwrite buf, which doesn't yet contain anything of value)
+	std::lock_guard<std::mutex> lock(getPlannerMutex());
+	FFTW<double>::Plan plan = FFTW<double>::planManyDFT(n, howMany, buf, buf, n, FFTW_FORWARD, getPlannerEffort());
+	plans.emplace(std::make_pair(n, howMany), plan);
+	return plan;
+}
+
+void OutOfCoreFFT::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(getPlannerMutex());
+		for (auto& p : plans) {
+			FFTW<double>::destroyPlan(p.second);
+		}
+	}
+	plans.clear();
+
+	if (buf != nullptr) {
+		FFTW<double>::free(buf);
+		buf = nullptr;
+	}
+
+	input.close();
+	output.close();
+	fftSize = 0;
+}
+
+} // namespace Sndspec
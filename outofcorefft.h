@@ -0,0 +1,98 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef OUTOFCOREFFT_H
+#define OUTOFCOREFFT_H
+
+#include "fftwtraits.h"
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Sndspec {
+
+// class OutOfCoreFFT : a (double-precision) real-to-complex FFT which is too large to be performed in memory.
+// The data is kept in memory-mapped scratch files, and the transform is performed in panels which fit within a RAM budget,
+// using the "four-step" decomposition of an FFT of size M = M1 * M2 (with the data viewed as an M1 x M2 matrix) :
+//  1. M2 FFTs of size M1 (the columns)
+//  2. multiplication by twiddle factors
+//  3. M1 FFTs of size M2 (the rows)
+//  4. transposition
+// Each panel is a group of adjacent columns (or rows), so the scratch files are accessed in long contiguous runs.
+// The real input of (even) size N is treated as a complex sequence of size M = N / 2, which is untangled into the spectrum afterwards.
+
+class OutOfCoreFFT
+{
+public:
+	using Complex = FFTW<double>::Complex;
+
+	OutOfCoreFFT() = default;
+	~OutOfCoreFFT();
+
+	OutOfCoreFFT(const OutOfCoreFFT&) = delete;
+	OutOfCoreFFT& operator=(const OutOfCoreFFT&) = delete;
+
+	// init() : create scratch files for an FFT of the given (even) size, in the given directory. Returns false on failure (eg when there isn't enough space for them).
+	// ramBudget : approximate upper limit (in bytes) on the memory used for buffers and mapped pages
+	bool init(int64_t fftSize, size_t ramBudget, const std::string& scratchDirectory);
+
+	// writeInput() : copy count real values into the input, starting at position pos
+	void writeInput(int64_t pos, const double* data, int64_t count);
+
+	// exec() : perform the transform
+	void exec();
+
+	// calcMagSquared() : magnitude-squared of the spectrum (fftSize / 2 + 1 bins), reduced to results.size() bins
+	// by taking the maximum of each group of (spectrumSize / results.size(), rounded up) consecutive bins
+	void calcMagSquared(std::vector<double>& results);
+
+	int64_t getFFTSize() const
+	{
+		return fftSize;
+	}
+
+	int64_t getSpectrumSize() const
+	{
+		return fftSize / 2 + 1;
+	}
+
+	// getRows(), getColumns() : dimensions of the matrix of complex values
+	int64_t getRows() const
+	{
+		return m1;
+	}
+
+	int64_t getColumns() const
+	{
+		return m2;
+	}
+
+private:
+	int64_t fftSize{0};
+	int64_t m1{0}; // rows
+	int64_t m2{0}; // columns
+	int64_t columnsPerPanel{1};
+	int64_t rowsPerPanel{1};
+	MappedFile input; // natural order (steps 1-3 are performed in-place)
+	MappedFile output; // natural order (written by step 4)
+	Complex* buf{nullptr}; // panel buffer
+	std::map<std::pair<int, int>, FFTW<double>::Plan> plans; // <size, howMany> -> plan
+
+	FFTW<double>::Plan getPlan(int n, int howMany);
+	void close();
+};
+
+} // namespace Sndspec
+
+#endif // OUTOFCOREFFT_H
@@ -0,0 +1,59 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef PALETTETHRESHOLDS_H
+#define PALETTETHRESHOLDS_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace Sndspec {
+
+// PaletteThresholds : maps (linear) power or magnitude values directly to palette indices, without computing any logarithms.
+// The dB-based mapping is index = clamp(int(dB * numColors / -dynRange), 0, numColors - 1), where dB is relative to the peak.
+// Equivalently, index >= k whenever value <= peak * 10^(-k * dynRange / (dBMult * numColors)),
+// so the index is simply the number of thresholds which are >= value.
+// As with Spectrum::convertToDb(), values are floored at 300dB below the peak, so any threshold below that is omitted.
+
+template <typename T>
+class PaletteThresholds
+{
+public:
+	PaletteThresholds(int numColors, double dynRange, double peak, bool fromMagSquared = true)
+	{
+		const double dBMult = fromMagSquared ? 10.0 : 20.0;
+		const double floor = std::max(std::numeric_limits<double>::min(), peak * std::pow(10.0, -300.0 / dBMult));
+		for (int k = 1; k < numColors; k++) {
+			const double threshold = peak * std::pow(10.0, -k * dynRange / (dBMult * numColors));
+			if (threshold < floor) {
+				break;
+			}
+			thresholds.push_back(static_cast<T>(threshold));
+		}
+	}
+
+	// getIndex() : returns palette index for value. (A branchless count is faster than a binary search for a palette-sized table)
+	int getIndex(T value) const
+	{
+		int index = 0;
+		for (T threshold : thresholds) {
+			index += (value <= threshold);
+		}
+		return index;
+	}
+
+private:
+	std::vector<T> thresholds; // descending order
+};
+
+} // namespace Sndspec
+
+#endif // PALETTETHRESHOLDS_H
@@ -17,6 +17,7 @@
 #define VERSION_STRING STRINGIFY(SNDSPEC_VERSION)
 #endif
 
+#include <cctype>
 #include <cmath>
 #include <sstream>
 #include <iterator>
@@ -27,6 +28,38 @@ namespace Sndspec {
 constexpr int minImgWidth = 160;
 constexpr int minImgHeight = 160;
 
+// parseNumber() : sets val and returns true only if the whole of s is a number
+// (so that an optional numerical parameter isn't confused with a filename which begins with digits, such as 01-track.flac)
+static bool parseNumber(const std::string& s, int& val)
+{
+	try {
+		size_t pos = 0;
+		const int v = std::stoi(s, &pos);
+		if (pos == s.size()) {
+			val = v;
+			return true;
+		}
+	} catch (const std::invalid_argument& e) {
+	} catch (const std::out_of_range& e) {
+	}
+	return false;
+}
+
+static bool parseNumber(const std::string& s, double& val)
+{
+	try {
+		size_t pos = 0;
+		const double v = std::stod(s, &pos);
+		if (pos == s.size()) {
+			val = v;
+			return true;
+		}
+	} catch (const std::invalid_argument& e) {
+	} catch (const std::out_of_range& e) {
+	}
+	return false;
+}
+
 std::vector<std::string> Parameters::getInputFiles() const
 {
 	return inputFiles;
@@ -135,8 +168,8 @@ std::string Parameters::fromArgs(const std::vector<std::string> &args)
 				start = std::max(0.0, std::stod(*argsIt));
 				if (++argsIt != args.cend()) {
 					finish = std::max(0.0, std::stod(*argsIt));
+					++argsIt;
 				}
-				++argsIt;
 			}
 			break;
 
@@ -217,6 +250,26 @@ std::string Parameters::fromArgs(const std::vector<std::string> &args)
 			break;
 		}
 
+		case Panes:
+			channelLayout = LayoutStacked;
+			if (++argsIt != args.cend()) {
+				std::string s{*argsIt};
+
+				// convert name to lowercase
+				std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> unsigned char {
+					return std::tolower(c);
+				});
+
+				// optional layout name (anything else is left for the next option, or treated as a filename)
+				if (s.compare(0, 4, "tile") == 0) {
+					channelLayout = LayoutTiled;
+					++argsIt;
+				} else if (s.compare(0, 5, "stack") == 0) {
+					++argsIt;
+				}
+			}
+			break;
+
 		case LinearMag:
 			linearMag = true;
 			dynRange = 100.0;
@@ -302,6 +355,245 @@ std::string Parameters::fromArgs(const std::vector<std::string> &args)
 			++argsIt;
 			break;
 
+		case Jobs:
+			if (++argsIt != args.cend()) {
+				jobs = std::max(1, std::stoi(*argsIt));
+				++argsIt;
+			}
+			break;
+
+		case Threads:
+			if (++argsIt != args.cend()) {
+				threads = std::max(0, std::stoi(*argsIt));
+				++argsIt;
+			}
+			break;
+
+		case ReadMode:
+			if (++argsIt != args.cend()) {
+				std::string s{*argsIt};
+
+				// convert name to lowercase
+				std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> unsigned char {
+					return std::tolower(c);
+				});
+
+				if (s.compare(0, 4, "seek") == 0) {
+					readMode = ReadSeek;
+				} else if (s.compare(0, 6, "stream") == 0) {
+					readMode = ReadStream;
+				} else {
+					readMode = ReadAuto;
+				}
+				++argsIt;
+			}
+			break;
+
+		case Precision:
+			if (++argsIt != args.cend()) {
+				std::string s{*argsIt};
+
+				// convert name to lowercase
+				std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> unsigned char {
+					return std::tolower(c);
+				});
+
+				precision = (s.compare(0, 6, "single") == 0 || s.compare(0, 5, "float") == 0) ? PrecisionSingle : PrecisionDouble;
+				++argsIt;
+			}
+			break;
+
+		case FastPreview:
+			fastPreview = true;
+			++argsIt;
+			break;
+
+		case ColumnAverage:
+			if (++argsIt != args.cend()) {
+				columnAverage = std::max(1, std::stoi(*argsIt));
+				++argsIt;
+			}
+			break;
+
+		case ColumnAggregate:
+			if (++argsIt != args.cend()) {
+				std::string s{*argsIt};
+
+				// convert name to lowercase
+				std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> unsigned char {
+					return std::tolower(c);
+				});
+
+				if (s.compare(0, 3, "max") == 0) {
+					columnAggregation = AggregateMax;
+				} else if (s.compare(0, 4, "mean") == 0) {
+					columnAggregation = AggregateMean;
+				} else if (s.compare(0, 4, "perc") == 0) {
+					columnAggregation = AggregatePercentile;
+				} else {
+					columnAggregation = AggregateNone;
+				}
+				++argsIt;
+
+				// optional percentile
+				double percentile;
+				if (columnAggregation == AggregatePercentile && argsIt != args.cend() && parseNumber(*argsIt, percentile)) {
+					columnPercentile = std::max(0.0, std::min(100.0, percentile));
+					++argsIt;
+				}
+			}
+			break;
+
+		case ReadAheadDepth:
+			if (++argsIt != args.cend()) {
+				readAhead = std::max(0, std::stoi(*argsIt));
+				++argsIt;
+			}
+			break;
+
+		case FFTBatch:
+			if (++argsIt != args.cend()) {
+				fftBatch = std::max(1, std::stoi(*argsIt));
+				++argsIt;
+			}
+			break;
+
+		case PlanEffort:
+			if (++argsIt != args.cend()) {
+				std::string s{*argsIt};
+
+				// convert name to lowercase
+				std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> unsigned char {
+					return std::tolower(c);
+				});
+
+				if (s.compare(0, 8, "estimate") == 0) {
+					planEffort = PlanEstimate;
+				} else if (s.compare(0, 7, "patient") == 0) {
+					planEffort = PlanPatient;
+				} else if (s.compare(0, 10, "exhaustive") == 0) {
+					planEffort = PlanExhaustive;
+				} else {
+					planEffort = PlanMeasure;
+				}
+				++argsIt;
+			}
+			break;
+
+		case WarmWisdom:
+			warmWisdom = true;
+			++argsIt;
+
+			// optional list of image heights
+			while (argsIt != args.cend() && !argsIt->empty() && std::isdigit(static_cast<unsigned char>(argsIt->at(0)))) {
+				warmWisdomHeights.push_back(std::max(minImgHeight, std::stoi(*argsIt)));
+				++argsIt;
+			}
+			break;
+
+		case WelchAverage:
+		{
+			welch = true;
+			spectrumMode = true;
+			++argsIt;
+
+			// optional segment size, followed by optional overlap (in percent)
+			int segmentSize;
+			if (argsIt != args.cend() && parseNumber(*argsIt, segmentSize)) {
+				welchSegmentSize = std::max(16, segmentSize);
+				++argsIt;
+				double overlap;
+				if (argsIt != args.cend() && parseNumber(*argsIt, overlap)) {
+					welchOverlap = std::max(0.0, std::min(95.0, overlap));
+					++argsIt;
+				}
+			}
+			break;
+		}
+
+		case RamBudget:
+			if (++argsIt != args.cend()) {
+				ramBudget = std::max(0, std::stoi(*argsIt));
+				++argsIt;
+			}
+			break;
+
+		case FreqRange:
+			// (both frequencies are required)
+			if (++argsIt != args.cend()) {
+				lowFreq = std::max(0.0, std::stod(*argsIt));
+				if (++argsIt != args.cend()) {
+					highFreq = std::max(0.0, std::stod(*argsIt));
+					freqRange = true;
+					spectrumMode = true;
+					++argsIt;
+				}
+			}
+			break;
+
+		case PngLevel:
+			if (++argsIt != args.cend()) {
+				pngLevel = std::max(0, std::min(9, std::stoi(*argsIt)));
+				++argsIt;
+			}
+			break;
+
+		case PngPalette:
+			pngPalette = true;
+			++argsIt;
+			break;
+
+		case Rendition:
+			if (++argsIt != args.cend()) {
+				// size, in the form <width>x<height>
+				RenditionSpec rendition{imgWidth, imgHeight, std::nullopt, std::nullopt};
+				const std::string size{*argsIt};
+				const auto x = size.find_first_of("xX");
+				int w, h;
+				if (x == std::string::npos || !parseNumber(size.substr(0, x), w) || !parseNumber(size.substr(x + 1), h)) {
+					break; // (not a size: leave it for the next option, or treat it as a filename)
+				}
+				rendition.width = std::max(minImgWidth, w);
+				rendition.height = std::max(minImgHeight, h);
+				++argsIt;
+
+				// optional dynamic range and background
+				while (argsIt != args.cend() && !argsIt->empty() && argsIt->compare(0, 1, "-") != 0) {
+					std::string s{*argsIt};
+
+					// convert name to lowercase
+					std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> unsigned char {
+						return std::tolower(c);
+					});
+
+					double d;
+					if (s == "white") {
+						rendition.whiteBackground = true;
+					} else if (s == "black") {
+						rendition.whiteBackground = false;
+					} else if (parseNumber(s, d)) {
+						rendition.dynRange = std::abs(d);
+					} else {
+						break;
+					}
+					++argsIt;
+				}
+
+				renditions.push_back(rendition);
+			}
+			break;
+
+		case Cache:
+			analysisCache = true;
+			if (++argsIt != args.cend()) {
+				int size;
+				if (parseNumber(*argsIt, size)) {
+					cacheSize = std::max(1, size);
+					++argsIt;
+				}
+			}
+			break;
+
 #ifdef SNDSPEC_VERSION
 		case Version:
 			++argsIt;
@@ -441,6 +733,11 @@ ChannelMode Parameters::getChannelMode() const
 	return channelMode;
 }
 
+ChannelLayout Parameters::getChannelLayout() const
+{
+	return channelLayout;
+}
+
 bool Parameters::getLinearMag() const
 {
 	return linearMag;
@@ -491,6 +788,256 @@ void Parameters::setWindowFunctionParameters(const std::vector<double>& newWindo
 	windowFunctionParameters = newWindowFunctionParameters;
 }
 
+int Parameters::getJobs() const
+{
+	return jobs;
+}
+
+void Parameters::setJobs(int val)
+{
+	jobs = val;
+}
+
+int Parameters::getThreads() const
+{
+	return threads;
+}
+
+void Parameters::setThreads(int val)
+{
+	threads = val;
+}
+
+FileReadMode Parameters::getReadMode() const
+{
+	return readMode;
+}
+
+void Parameters::setReadMode(const FileReadMode &val)
+{
+	readMode = val;
+}
+
+FloatPrecision Parameters::getPrecision() const
+{
+	return precision;
+}
+
+void Parameters::setPrecision(const FloatPrecision &val)
+{
+	precision = val;
+}
+
+bool Parameters::getFastPreview() const
+{
+	return fastPreview;
+}
+
+void Parameters::setFastPreview(bool val)
+{
+	fastPreview = val;
+}
+
+int Parameters::getColumnAverage() const
+{
+	return columnAverage;
+}
+
+void Parameters::setColumnAverage(int val)
+{
+	columnAverage = val;
+}
+
+ColumnAggregation Parameters::getColumnAggregation() const
+{
+	return columnAggregation;
+}
+
+void Parameters::setColumnAggregation(const ColumnAggregation &val)
+{
+	columnAggregation = val;
+}
+
+double Parameters::getColumnPercentile() const
+{
+	return columnPercentile;
+}
+
+void Parameters::setColumnPercentile(double val)
+{
+	columnPercentile = val;
+}
+
+int Parameters::getReadAhead() const
+{
+	return readAhead;
+}
+
+void Parameters::setReadAhead(int val)
+{
+	readAhead = val;
+}
+
+int Parameters::getFFTBatch() const
+{
+	return fftBatch;
+}
+
+void Parameters::setFFTBatch(int val)
+{
+	fftBatch = val;
+}
+
+FFTPlanEffort Parameters::getPlanEffort() const
+{
+	return planEffort;
+}
+
+void Parameters::setPlanEffort(const FFTPlanEffort &val)
+{
+	planEffort = val;
+}
+
+bool Parameters::getWarmWisdom() const
+{
+	return warmWisdom;
+}
+
+void Parameters::setWarmWisdom(bool val)
+{
+	warmWisdom = val;
+}
+
+std::vector<int> Parameters::getWarmWisdomHeights() const
+{
+	return warmWisdomHeights;
+}
+
+void Parameters::setWarmWisdomHeights(const std::vector<int> &val)
+{
+	warmWisdomHeights = val;
+}
+
+bool Parameters::getWelch() const
+{
+	return welch;
+}
+
+void Parameters::setWelch(bool val)
+{
+	welch = val;
+}
+
+int Parameters::getWelchSegmentSize() const
+{
+	return welchSegmentSize;
+}
+
+void Parameters::setWelchSegmentSize(int val)
+{
+	welchSegmentSize = val;
+}
+
+double Parameters::getWelchOverlap() const
+{
+	return welchOverlap;
+}
+
+void Parameters::setWelchOverlap(double val)
+{
+	welchOverlap = val;
+}
+
+int Parameters::getRamBudget() const
+{
+	return ramBudget;
+}
+
+void Parameters::setRamBudget(int val)
+{
+	ramBudget = val;
+}
+
+bool Parameters::hasFreqRange() const
+{
+	return freqRange;
+}
+
+void Parameters::setHasFreqRange(bool val)
+{
+	freqRange = val;
+}
+
+double Parameters::getLowFreq() const
+{
+	return lowFreq;
+}
+
+void Parameters::setLowFreq(double val)
+{
+	lowFreq = val;
+}
+
+double Parameters::getHighFreq() const
+{
+	return highFreq;
+}
+
+void Parameters::setHighFreq(double val)
+{
+	highFreq = val;
+}
+
+int Parameters::getPngLevel() const
+{
+	return pngLevel;
+}
+
+void Parameters::setPngLevel(int val)
+{
+	pngLevel = val;
+}
+
+bool Parameters::getPngPalette() const
+{
+	return pngPalette;
+}
+
+void Parameters::setPngPalette(bool val)
+{
+	pngPalette = val;
+}
+
+std::vector<RenditionSpec> Parameters::getRenditions() const
+{
+	return renditions;
+}
+
+void Parameters::setRenditions(const std::vector<RenditionSpec> &val)
+{
+	renditions = val;
+}
+
+bool Parameters::getAnalysisCache() const
+{
+	return analysisCache;
+}
+
+void Parameters::setAnalysisCache(bool val)
+{
+	analysisCache = val;
+}
+
+int Parameters::getCacheSize() const
+{
+	return cacheSize;
+}
+
+void Parameters::setCacheSize(int val)
+{
+	cacheSize = val;
+}
+
 void Parameters::setHorizZoomFactor(double newHorizZoomFactor)
 {
 	horizZoomFactor = newHorizZoomFactor;
@@ -526,6 +1073,11 @@ void Parameters::setChannelMode(const ChannelMode &val)
 	channelMode = val;
 }
 
+void Parameters::setChannelLayout(const ChannelLayout &val)
+{
+	channelLayout = val;
+}
+
 void Parameters::setSelectedChannels(const std::set<int> &val)
 {
 	selectedChannels = val;
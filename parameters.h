@@ -58,11 +58,30 @@ enum OptionID
 	SpectrumMode,
 	Smoothing,
 	Channel,
+	Panes,
 	LinearMag,
 	FrequencyStep,
 	PeakSelection,
 	PlotWindowFunction,
 	Recursive,
+	Jobs,
+	Threads,
+	ReadMode,
+	ReadAheadDepth,
+	FastPreview,
+	ColumnAverage,
+	ColumnAggregate,
+	Precision,
+	FFTBatch,
+	PlanEffort,
+	WarmWisdom,
+	WelchAverage,
+	RamBudget,
+	FreqRange,
+	PngLevel,
+	PngPalette,
+	Rendition,
+	Cache,
 	Version,
 	Zoom,
 	Help
@@ -92,6 +111,51 @@ enum ChannelMode
 	Difference
 };
 
+enum ChannelLayout
+{
+	LayoutSingle, // first enabled channel only
+	LayoutStacked, // one pane per enabled channel, one above the other
+	LayoutTiled // one pane per enabled channel, in a grid
+};
+
+enum FileReadMode
+{
+	ReadAuto, // stream when blocks overlap or are close together, otherwise seek
+	ReadSeek, // seek to each block
+	ReadStream // decode the whole time range once, sequentially
+};
+
+enum ColumnAggregation
+{
+	AggregateNone, // one block per column (or the average of --column-average blocks)
+	AggregateMax, // max-hold of every block in the column
+	AggregateMean, // mean power of every block in the column
+	AggregatePercentile // given percentile of the power of every block in the column
+};
+
+// RenditionSpec : an additional output image, rendered from the same analysis as the main image
+struct RenditionSpec
+{
+	int width;
+	int height;
+	std::optional<double> dynRange; // (default: same as the main image)
+	std::optional<bool> whiteBackground; // (default: same as the main image)
+};
+
+enum FloatPrecision
+{
+	PrecisionDouble,
+	PrecisionSingle // fftwf : halves the memory traffic. Adequate for dynamic ranges up to about 140dB
+};
+
+enum FFTPlanEffort
+{
+	PlanEstimate,
+	PlanMeasure,
+	PlanPatient,
+	PlanExhaustive
+};
+
 const std::vector<Option> options
 {
 	{OptionID::DynRange, "--dyn-range", "", false, "Set Dynamic Range in dB", {"n"}},
@@ -105,11 +169,30 @@ const std::vector<Option> options
 	{OptionID::SpectrumMode, "--spectrum", "", false, "Plot a Spectrum instead of Spectrogram", {}},
 	{OptionID::Smoothing, "--smoothing", "-S", false, "Set Spectrum Smoothing Mode (default:peak)", {"moving average|peak|none"}},
 	{OptionID::Channel, "--channel", "-c", false, "select specific channels and set channel mode", {"[all|[L|R|0|1|2|...]...] [sum|difference|normal]"}},
+	{OptionID::Panes, "--panes", "", false, "Plot each selected channel of a spectrogram in its own pane (default: first channel only)", {"stacked|tiled"}},
 	{OptionID::LinearMag, "--linear-mag", "-l", false, "Set magnitude scale to be linear", {}},
 	{OptionID::FrequencyStep, "--frequency-step", "-f", false, "Set interval of frequency tick marks in Hz", {"n"}},
 	{OptionID::PeakSelection, "--peak-selection", "-p", false, "Annotate the top n local peaks in the results", {"n [min-spacing(Hz)]"}},
 	{OptionID::PlotWindowFunction, "--plot-window", "", false, "Plot window function", {"name [time domain]"}},
 	{OptionID::Recursive, "--recursive", "-r", false, "Recursive directory traversal", {}},
+	{OptionID::Jobs, "--jobs", "-j", false, "Set number of files to process concurrently (default:1)", {"n"}},
+	{OptionID::Threads, "--threads", "", false, "Set number of analysis threads per file (default:auto)", {"n"}},
+	{OptionID::ReadMode, "--read-mode", "", false, "Set spectrogram file reading mode (default:auto)", {"auto|seek|stream"}},
+	{OptionID::FastPreview, "--fast-preview", "", false, "Read only one FFT block per spectrogram column, seeking over the rest (fastest for long recordings)", {}},
+	{OptionID::ColumnAverage, "--column-average", "", false, "Average the spectra of n evenly-spaced blocks in each spectrogram column (default:1)", {"n"}},
+	{OptionID::ColumnAggregate, "--column-aggregate", "", false, "Analyze every block in each spectrogram column, and reduce them to a single spectrum (default percentile:95)", {"max|mean|percentile [p]"}},
+	{OptionID::ReadAheadDepth, "--read-ahead", "", false, "Decode spectrogram columns on a separate thread, up to n columns ahead (default:0 = off)", {"n"}},
+	{OptionID::Precision, "--precision", "", false, "Set spectrogram analysis precision (default:double)", {"single|double"}},
+	{OptionID::FFTBatch, "--fft-batch", "", false, "Set number of spectrogram columns transformed together (default:8)", {"n"}},
+	{OptionID::PlanEffort, "--plan-effort", "", false, "Set FFT planning effort (default:measure)", {"estimate|measure|patient|exhaustive"}},
+	{OptionID::WarmWisdom, "--warm-wisdom", "", false, "Pre-plan FFTs for the given image heights (default: current height) and save the wisdom", {"[height ...]"}},
+	{OptionID::WelchAverage, "--welch", "", false, "Plot an averaged spectrum of overlapping segments (default: 65536 samples, 50% overlap)", {"[segment-size [overlap(%)]]"}},
+	{OptionID::RamBudget, "--ram-budget", "", false, "Set memory limit in MB for a spectrum FFT; larger FFTs use scratch files (default:unlimited)", {"n"}},
+	{OptionID::FreqRange, "--freq-range", "", false, "Plot a spectrum of only the given frequency range (zoom FFT)", {"low-freq(Hz)", "high-freq(Hz)"}},
+	{OptionID::PngLevel, "--png-level", "", false, "Set PNG compression level, from 0 (fastest) to 9 (smallest) (default:6)", {"n"}},
+	{OptionID::PngPalette, "--png-palette", "", false, "Write 8-bit palette PNGs, where the image has no more than 256 colors (smaller and faster)", {}},
+	{OptionID::Rendition, "--rendition", "", false, "Also render each spectrogram at another size (repeatable; all sizes share one analysis)", {"WxH [dyn-range] [white|black]"}},
+	{OptionID::Cache, "--cache", "", false, "Keep spectrogram analysis results on disk, and re-use them when re-rendering (default size limit: 1024MB)", {"[max-size(MB)]"}},
 
 #ifdef SNDSPEC_VERSION
 	{OptionID::Version, "--version", "", false, "Show program version", {}},
@@ -146,6 +229,7 @@ public:
 	void setSpectrumSmoothingMode(const SpectrumSmoothingMode &val);
 	void setSelectedChannels(const std::set<int> &val);
 	void setChannelMode(const ChannelMode &val);
+	void setChannelLayout(const ChannelLayout &val);
 	void setLinearMag(bool val);
 	void setFrequencyStep(int val);
 	void setTopN(std::optional<int> val);
@@ -154,6 +238,31 @@ public:
 	void setPlotTimeDomain(bool val);
 	void setHorizZoomFactor(double newHorizZoomFactor);
 	void setWindowFunctionParameters(const std::vector<double>& newWindowFunctionParameters);
+	void setJobs(int val);
+	void setThreads(int val);
+	void setReadMode(const FileReadMode &val);
+	void setReadAhead(int val);
+	void setFastPreview(bool val);
+	void setColumnAverage(int val);
+	void setColumnAggregation(const ColumnAggregation &val);
+	void setColumnPercentile(double val);
+	void setPrecision(const FloatPrecision &val);
+	void setFFTBatch(int val);
+	void setPlanEffort(const FFTPlanEffort &val);
+	void setWarmWisdom(bool val);
+	void setWarmWisdomHeights(const std::vector<int> &val);
+	void setWelch(bool val);
+	void setWelchSegmentSize(int val);
+	void setWelchOverlap(double val);
+	void setRamBudget(int val);
+	void setHasFreqRange(bool val);
+	void setLowFreq(double val);
+	void setHighFreq(double val);
+	void setPngLevel(int val);
+	void setPngPalette(bool val);
+	void setRenditions(const std::vector<RenditionSpec> &val);
+	void setAnalysisCache(bool val);
+	void setCacheSize(int val);
 
 	// getters
 	std::vector<std::string> getInputFiles() const;
@@ -173,6 +282,7 @@ public:
 	SpectrumSmoothingMode getSpectrumSmoothingMode() const;
 	std::set<int> getSelectedChannels() const;
 	ChannelMode getChannelMode() const;
+	ChannelLayout getChannelLayout() const;
 	bool getLinearMag() const;
 	int getFrequencyStep() const;
 	std::optional<int> getTopN() const;
@@ -181,15 +291,46 @@ public:
 	bool plotTimeDomain() const;
 	double getHorizZoomFactor() const;
 	std::vector<double> getWindowFunctionParameters() const;
+	int getJobs() const;
+	int getThreads() const;
+	FileReadMode getReadMode() const;
+	int getReadAhead() const;
+	bool getFastPreview() const;
+	int getColumnAverage() const;
+	ColumnAggregation getColumnAggregation() const;
+	double getColumnPercentile() const;
+	FloatPrecision getPrecision() const;
+	int getFFTBatch() const;
+	FFTPlanEffort getPlanEffort() const;
+	bool getWarmWisdom() const;
+	std::vector<int> getWarmWisdomHeights() const;
+	bool getWelch() const;
+	int getWelchSegmentSize() const;
+	double getWelchOverlap() const;
+	int getRamBudget() const;
+	bool hasFreqRange() const;
+	double getLowFreq() const;
+	double getHighFreq() const;
+	int getPngLevel() const;
+	bool getPngPalette() const;
+	std::vector<RenditionSpec> getRenditions() const;
+	bool getAnalysisCache() const;
+	int getCacheSize() const;
 
 private:
 	double dynRange{190};
 	double start{0.0};
 	double finish{0.0};
+	double lowFreq{0.0};
+	double highFreq{0.0};
 	double horizZoomFactor{1.0};
+	double welchOverlap{50.0}; // percent
+	double columnPercentile{95.0};
 	std::optional<double> topN_minSpacing;
 	std::vector<std::string> inputFiles;
 	std::vector<double> windowFunctionParameters;
+	std::vector<int> warmWisdomHeights;
+	std::vector<RenditionSpec> renditions;
 	std::string outputPath;
 	std::string windowFunction{"kaiser"};
 	std::string windowFunctionDisplayName{"Kaiser"};
@@ -198,9 +339,24 @@ private:
 	int imgHeight{768};
 	SpectrumSmoothingMode spectrumSmoothingMode{Peak};
 	ChannelMode channelMode{Normal};
+	ChannelLayout channelLayout{LayoutSingle};
+	FileReadMode readMode{ReadAuto};
+	ColumnAggregation columnAggregation{AggregateNone};
+	FloatPrecision precision{PrecisionDouble};
+	FFTPlanEffort planEffort{PlanMeasure};
 	int frequencyStep{5000};
 	std::optional<int> topN;
+	int jobs{1};
+	int threads{0}; // 0 : automatic
+	int readAhead{0}; // 0 : off
+	int columnAverage{1};
+	int fftBatch{8};
+	int welchSegmentSize{65536};
+	int ramBudget{0}; // MB; 0 : unlimited
+	int pngLevel{6};
+	int cacheSize{1024}; // MB
 	bool timeRange{false};
+	bool freqRange{false};
 	bool whiteBackground{false};
 	bool showWindowFunctionLabel{false}; // flag to show the name of window function on the rendered output
 	bool showWindows{false}; // flag to provide a list of available window functions
@@ -209,6 +365,11 @@ private:
 	bool plotTimeDomain_{false};
 	bool linearMag{false};
 	bool recursiveDirectoryTraversal{false};
+	bool warmWisdom{false};
+	bool welch{false};
+	bool fastPreview{false};
+	bool pngPalette{false};
+	bool analysisCache{false};
 
 	void processChannelArgs(const std::vector<std::string> &args);
 };
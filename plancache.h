@@ -0,0 +1,209 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include "fftwtraits.h"
+
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace Sndspec {
+
+// PlanCache<FloatType> : process-wide, thread-safe pool of fftw plans and fftw-allocated buffers (one pool for each precision).
+// Plans are keyed by (fft size, batch size, slot distances, flags), are created once, and are shared by all analyzers which need them.
+// Shared plans are executed with the new-array execute function (fftw_execute_dft_r2c), which is thread-safe,
+// using the caller's own buffers. All buffers come from the pool, so they all have the alignment which fftw expects.
+// Released buffers are kept for re-use, so after the first file, creating an analyzer requires neither planning nor allocation.
+// The free buffers are limited to a total size (see setMaxFreeBytes()), beyond which the least-recently released buffers are freed.
+// (One-off sizes, such as the single large FFT of a spectrum, should use makePlan() and their own buffers instead, so that they aren't kept)
+
+template <typename FloatType>
+class PlanCache
+{
+public:
+	using Plan = typename FFTW<FloatType>::Plan;
+	using Complex = typename FFTW<FloatType>::Complex;
+
+	static PlanCache& getInstance()
+	{
+		static PlanCache instance;
+		return instance;
+	}
+
+	// getPlan() : returns an out-of-place r2c plan for batchSize transforms of size fftSize,
+	// with input and output slots tdDist and fdDist elements apart, creating it if necessary.
+	// A new plan is made using the caller's buffers, in and out (the contents of which may be overwritten by planning).
+	// Planning (which can take seconds) is done without holding the pool's mutex, so that other threads can still acquire and release buffers
+	Plan getPlan(int fftSize, int batchSize, int tdDist, int fdDist, unsigned flags, FloatType* in, Complex* out)
+	{
+		const auto key = std::make_tuple(fftSize, batchSize, tdDist, fdDist, flags);
+		if (const Plan plan = findPlan(key)) {
+			return plan;
+		}
+
+		std::lock_guard<std::mutex> plannerLock(getPlannerMutex());
+
+		// another thread may have made the plan while this one was waiting for the planner
+		if (const Plan plan = findPlan(key)) {
+			return plan;
+		}
+
+		const Plan plan = createPlan(fftSize, batchSize, tdDist, fdDist, flags, in, out);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto inserted = plans.emplace(key, plan);
+		if (!inserted.second) {
+			FFTW<FloatType>::destroyPlan(plan);
+		}
+		return inserted.first->second;
+	}
+
+	// makePlan() : create a plan which is not cached. The caller owns the plan, and must destroy it with destroyPlan()
+	static Plan makePlan(int fftSize, int batchSize, int tdDist, int fdDist, unsigned flags, FloatType* in, Complex* out)
+	{
+		std::lock_guard<std::mutex> plannerLock(getPlannerMutex());
+		return createPlan(fftSize, batchSize, tdDist, fdDist, flags, in, out);
+	}
+
+	static void destroyPlan(Plan plan)
+	{
+		std::lock_guard<std::mutex> plannerLock(getPlannerMutex());
+		FFTW<FloatType>::destroyPlan(plan);
+	}
+
+	FloatType* acquireReal(size_t n)
+	{
+		return static_cast<FloatType*>(acquire(n, false));
+	}
+
+	void releaseReal(FloatType* p, size_t n)
+	{
+		release(p, n, false, n * sizeof(FloatType));
+	}
+
+	Complex* acquireComplex(size_t n)
+	{
+		return static_cast<Complex*>(acquire(n, true));
+	}
+
+	void releaseComplex(Complex* p, size_t n)
+	{
+		release(p, n, true, n * sizeof(Complex));
+	}
+
+	size_t getMaxFreeBytes()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return maxFreeBytes;
+	}
+
+	// setMaxFreeBytes() : set the limit on the total size of the free buffers (default 64MB)
+	void setMaxFreeBytes(size_t value)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		maxFreeBytes = value;
+		trim();
+	}
+
+	PlanCache(const PlanCache&) = delete;
+	PlanCache& operator=(const PlanCache&) = delete;
+
+private:
+	// FreeBuffer : a released buffer of n reals or complexes
+	struct FreeBuffer
+	{
+		void* p;
+		size_t n;
+		bool complex;
+		size_t bytes;
+	};
+
+	using Key = std::tuple<int, int, int, int, unsigned>;
+
+	PlanCache() = default;
+
+	~PlanCache()
+	{
+		for (auto& entry : plans) {
+			FFTW<FloatType>::destroyPlan(entry.second);
+		}
+		for (auto& buffer : freeBuffers) {
+			FFTW<FloatType>::free(buffer.p);
+		}
+	}
+
+	// findPlan() : returns the cached plan for the given key, or nullptr
+	Plan findPlan(const Key& key)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = plans.find(key);
+		return (it != plans.end()) ? it->second : nullptr;
+	}
+
+	// createPlan() : (the caller must hold the planner mutex)
+	static Plan createPlan(int fftSize, int batchSize, int tdDist, int fdDist, unsigned flags, FloatType* in, Complex* out)
+	{
+		if (batchSize == 1) {
+			return FFTW<FloatType>::planR2C(fftSize, in, out, flags);
+		}
+		return FFTW<FloatType>::planManyR2C(fftSize, batchSize, in, tdDist, out, fdDist, flags);
+	}
+
+	// acquire() : take the most-recently released free buffer of exactly n elements, or allocate a new one
+	void* acquire(size_t n, bool complex)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto it = freeBuffers.rbegin(); it != freeBuffers.rend(); ++it) {
+				if (it->n == n && it->complex == complex) {
+					void* p = it->p;
+					freeBytes -= it->bytes;
+					freeBuffers.erase(std::next(it).base());
+					return p;
+				}
+			}
+		}
+
+		return complex ? static_cast<void*>(FFTW<FloatType>::allocComplex(n)) : static_cast<void*>(FFTW<FloatType>::allocReal(n));
+	}
+
+	void release(void* p, size_t n, bool complex, size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		freeBuffers.push_back({p, n, complex, bytes});
+		freeBytes += bytes;
+		trim();
+	}
+
+	// trim() : free the least-recently released buffers, until the free buffers are within maxFreeBytes
+	void trim()
+	{
+		while (freeBytes > maxFreeBytes && !freeBuffers.empty()) {
+			FFTW<FloatType>::free(freeBuffers.front().p);
+			freeBytes -= freeBuffers.front().bytes;
+			freeBuffers.pop_front();
+		}
+	}
+
+	std::mutex mutex;
+	std::map<Key, Plan> plans;
+	std::list<FreeBuffer> freeBuffers; // (least-recently released first)
+	size_t freeBytes{0};
+	size_t maxFreeBytes{size_t{64} << 20};
+};
+
+} // namespace Sndspec
+
+#endif // PLANCACHE_H
@@ -0,0 +1,377 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "pngwriter.h"
+#include "batch.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#ifdef SNDSPEC_ZLIB
+#include <zlib.h>
+#endif
+
+namespace Sndspec {
+
+#ifdef SNDSPEC_ZLIB
+
+namespace {
+
+constexpr size_t stripBytes = 256 * 1024; // (approximate) size of each strip of filtered image data
+constexpr size_t windowBytes = 32768; // size of the deflate window
+
+// class ColorTable : the distinct colors of an image (up to 256 of them), and their palette indices
+class ColorTable
+{
+public:
+	static constexpr uint32_t noColor = 0xffffffff; // (never a color : the unused top 8 bits of each pixel are masked off)
+
+	ColorTable()
+	{
+		keys.fill(noColor);
+	}
+
+	// insert() : add the color (if it is new). Returns false if there are too many colors for a palette
+	bool insert(uint32_t color)
+	{
+		size_t i = getSlot(color);
+		while (keys[i] != noColor) {
+			if (keys[i] == color) {
+				return true;
+			}
+			i = (i + 1) & (tableSize - 1);
+		}
+
+		if (palette.size() == maxColors) {
+			return false;
+		}
+
+		keys[i] = color;
+		indices[i] = static_cast<uint8_t>(palette.size());
+		palette.push_back(color);
+		return true;
+	}
+
+	// find() : palette index of the color (which must already have been inserted)
+	uint8_t find(uint32_t color) const
+	{
+		size_t i = getSlot(color);
+		while (keys[i] != color) {
+			i = (i + 1) & (tableSize - 1);
+		}
+		return indices[i];
+	}
+
+	const std::vector<uint32_t>& getPalette() const
+	{
+		return palette;
+	}
+
+private:
+	static constexpr size_t maxColors = 256;
+	static constexpr size_t tableSize = 1024; // (a power of 2, and at most one quarter full)
+
+	std::array<uint32_t, tableSize> keys;
+	std::array<uint8_t, tableSize> indices{};
+	std::vector<uint32_t> palette;
+
+	static size_t getSlot(uint32_t color)
+	{
+		return static_cast<uint32_t>(color * UINT32_C(2654435761)) >> 22; // (top 10 bits of a multiplicative hash)
+	}
+};
+
+uint8_t paethPredictor(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	return static_cast<uint8_t>((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
+}
+
+// filterRow() : write the filter type, followed by the filtered row, to out, choosing whichever of the five PNG filters
+// gives the smallest sum of absolute (signed) differences (the heuristic suggested by the PNG specification).
+// prev is the (unfiltered) previous row (all zeroes for the first row), and bpp is the number of bytes per pixel
+void filterRow(const uint8_t* row, const uint8_t* prev, size_t rowBytes, size_t bpp, uint8_t* out, std::vector<uint8_t>& candidates)
+{
+	candidates.resize(5 * rowBytes);
+	uint8_t* none = candidates.data();
+	uint8_t* sub = none + rowBytes;
+	uint8_t* up = sub + rowBytes;
+	uint8_t* average = up + rowBytes;
+	uint8_t* paeth = average + rowBytes;
+
+	for (size_t i = 0; i < rowBytes; i++) {
+		const int a = (i >= bpp) ? row[i - bpp] : 0; // left
+		const int b = prev[i]; // above
+		const int c = (i >= bpp) ? prev[i - bpp] : 0; // above-left
+		none[i] = row[i];
+		sub[i] = static_cast<uint8_t>(row[i] - a);
+		up[i] = static_cast<uint8_t>(row[i] - b);
+		average[i] = static_cast<uint8_t>(row[i] - ((a + b) >> 1));
+		paeth[i] = static_cast<uint8_t>(row[i] - paethPredictor(a, b, c));
+	}
+
+	int best = 0;
+	uint64_t bestSum = UINT64_MAX;
+	for (int f = 0; f < 5; f++) {
+		const uint8_t* candidate = candidates.data() + f * rowBytes;
+		uint64_t sum = 0;
+		for (size_t i = 0; i < rowBytes; i++) {
+			sum += static_cast<uint64_t>(std::abs(static_cast<int8_t>(candidate[i])));
+		}
+		if (sum < bestSum) {
+			bestSum = sum;
+			best = f;
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(best);
+	std::copy(candidates.data() + best * rowBytes, candidates.data() + (best + 1) * rowBytes, out + 1);
+}
+
+// deflateStrip() : deflate data[begin, end) as one piece of a (raw) deflate stream, using the preceding data as a dictionary.
+// All but the last piece end on a byte boundary (with a sync flush), so that the pieces can simply be joined together
+bool deflateStrip(const uint8_t* data, size_t begin, size_t end, bool last, int level, int strategy, std::vector<uint8_t>& out)
+{
+	z_stream zs{};
+	if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+		return false;
+	}
+
+	if (begin > 0) {
+		const size_t dictionaryBytes = std::min(windowBytes, begin);
+		deflateSetDictionary(&zs, data + begin - dictionaryBytes, static_cast<uInt>(dictionaryBytes));
+	}
+
+	out.resize(deflateBound(&zs, static_cast<uLong>(end - begin)) + 16); // (allowing for the flush)
+	zs.next_in = const_cast<Bytef*>(data + begin);
+	zs.avail_in = static_cast<uInt>(end - begin);
+	zs.next_out = out.data();
+	zs.avail_out = static_cast<uInt>(out.size());
+
+	const int result = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+	const bool ok = last ? (result == Z_STREAM_END) : (result == Z_OK && zs.avail_in == 0 && zs.avail_out != 0);
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return ok;
+}
+
+void writeBE32(std::ofstream& file, uint32_t value)
+{
+	const char b[4] = {static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8), static_cast<char>(value)};
+	file.write(b, 4);
+}
+
+// writeChunk() : write a PNG chunk. data may be split into two parts (which are written one after the other)
+void writeChunk(std::ofstream& file, const char* type, const uint8_t* data, size_t length, const uint8_t* data2 = nullptr, size_t length2 = 0)
+{
+	writeBE32(file, static_cast<uint32_t>(length + length2));
+	file.write(type, 4);
+	uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(type), 4);
+	if (length > 0) {
+		file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length));
+		crc = crc32(crc, data, static_cast<uInt>(length));
+	}
+	if (length2 > 0) {
+		file.write(reinterpret_cast<const char*>(data2), static_cast<std::streamsize>(length2));
+		crc = crc32(crc, data2, static_cast<uInt>(length2));
+	}
+	writeBE32(file, static_cast<uint32_t>(crc));
+}
+
+} // namespace
+
+bool PngWriter::isAvailable()
+{
+	return true;
+}
+
+bool PngWriter::write(const std::string &filename, const uint32_t *pixels, int width, int height, int stride32) const
+{
+	if (pixels == nullptr || width <= 0 || height <= 0) {
+		return false;
+	}
+
+	// collect the distinct colors (stopping if there are too many for a palette)
+	ColorTable colors;
+	bool usePalette = indexed;
+	for (int y = 0; usePalette && y < height; y++) {
+		const uint32_t* row = pixels + static_cast<size_t>(y) * stride32;
+		uint32_t lastColor = ColorTable::noColor;
+		for (int x = 0; x < width; x++) {
+			const uint32_t color = row[x] & 0xffffff;
+			if (color != lastColor) {
+				if (!colors.insert(color)) {
+					usePalette = false;
+					break;
+				}
+				lastColor = color;
+			}
+		}
+	}
+
+	const size_t bpp = usePalette ? 1 : 3;
+	const size_t rowBytes = static_cast<size_t>(width) * bpp;
+	const size_t filteredRowBytes = rowBytes + 1; // (each row is preceded by its filter type)
+	std::vector<uint8_t> filtered(filteredRowBytes * height);
+
+	// convertRow() : convert row y to palette indices, or to (8-bit) RGB
+	auto convertRow = [&](int64_t y, uint8_t* out) {
+		const uint32_t* row = pixels + y * stride32;
+		if (usePalette) {
+			for (int x = 0; x < width; x++) {
+				out[x] = colors.find(row[x] & 0xffffff);
+			}
+		} else {
+			for (int x = 0; x < width; x++) {
+				out[3 * x] = static_cast<uint8_t>(row[x] >> 16);
+				out[3 * x + 1] = static_cast<uint8_t>(row[x] >> 8);
+				out[3 * x + 2] = static_cast<uint8_t>(row[x]);
+			}
+		}
+	};
+
+	// filter the rows (in parallel). Palette images aren't filtered (as recommended by the PNG specification)
+	runWorkStealing(height, numThreads, 16, [&](int t, int64_t yBegin, int64_t yEnd) {
+		(void)t;
+		std::vector<uint8_t> current(rowBytes);
+		std::vector<uint8_t> previous(rowBytes, 0);
+		std::vector<uint8_t> candidates;
+		if (yBegin > 0 && !usePalette) {
+			convertRow(yBegin - 1, previous.data());
+		}
+
+		for (int64_t y = yBegin; y < yEnd; y++) {
+			uint8_t* out = filtered.data() + y * filteredRowBytes;
+			if (usePalette) {
+				out[0] = 0;
+				convertRow(y, out + 1);
+			} else {
+				convertRow(y, current.data());
+				filterRow(current.data(), previous.data(), rowBytes, bpp, out, candidates);
+				std::swap(current, previous);
+			}
+		}
+	});
+
+	// deflate the strips (in parallel)
+	const size_t rowsPerStrip = std::max(size_t{1}, stripBytes / filteredRowBytes);
+	const int numStrips = static_cast<int>((static_cast<size_t>(height) + rowsPerStrip - 1) / rowsPerStrip);
+	std::vector<std::vector<uint8_t>> strips(numStrips);
+	std::vector<uLong> checksums(numStrips);
+	std::vector<char> stripOk(numStrips, 0);
+	const int strategy = usePalette ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+
+	runWorkStealing(numStrips, numThreads, 1, [&](int t, int64_t sBegin, int64_t sEnd) {
+		(void)t;
+		for (int64_t s = sBegin; s < sEnd; s++) {
+			const size_t begin = s * rowsPerStrip * filteredRowBytes;
+			const size_t end = std::min(filtered.size(), begin + rowsPerStrip * filteredRowBytes);
+			stripOk[s] = deflateStrip(filtered.data(), begin, end, s == numStrips - 1, compressionLevel, strategy, strips[s]);
+			checksums[s] = adler32(adler32(0L, Z_NULL, 0), filtered.data() + begin, static_cast<uInt>(end - begin));
+		}
+	});
+
+	if (std::find(stripOk.begin(), stripOk.end(), 0) != stripOk.end()) {
+		return false;
+	}
+
+	// the checksum of the whole stream
+	uLong adler = adler32(0L, Z_NULL, 0);
+	for (int s = 0; s < numStrips; s++) {
+		const size_t begin = s * rowsPerStrip * filteredRowBytes;
+		const size_t end = std::min(filtered.size(), begin + rowsPerStrip * filteredRowBytes);
+		adler = adler32_combine(adler, checksums[s], static_cast<z_off_t>(end - begin));
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	file.write(reinterpret_cast<const char*>(signature), 8);
+
+	const uint8_t header[13] = {
+		static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+		static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16), static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+		8, // bit depth
+		static_cast<uint8_t>(usePalette ? 3 : 2), // color type : palette or RGB
+		0, 0, 0 // compression, filter and interlace methods
+	};
+	writeChunk(file, "IHDR", header, sizeof(header));
+
+	if (usePalette) {
+		std::vector<uint8_t> palette;
+		for (uint32_t color : colors.getPalette()) {
+			palette.push_back(static_cast<uint8_t>(color >> 16));
+			palette.push_back(static_cast<uint8_t>(color >> 8));
+			palette.push_back(static_cast<uint8_t>(color));
+		}
+		writeChunk(file, "PLTE", palette.data(), palette.size());
+	}
+
+	// one IDAT chunk per strip : the zlib header goes at the front of the first, and the checksum at the end of the last
+	const int flevel = (compressionLevel < 2) ? 0 : (compressionLevel < 6) ? 1 : (compressionLevel == 6) ? 2 : 3;
+	unsigned int zlibHeader = (0x78 << 8) | (flevel << 6); // (deflate, with a 32K window)
+	zlibHeader += 31 - (zlibHeader % 31);
+	const uint8_t zlibHeaderBytes[2] = {static_cast<uint8_t>(zlibHeader >> 8), static_cast<uint8_t>(zlibHeader)};
+	strips.back().push_back(static_cast<uint8_t>(adler >> 24));
+	strips.back().push_back(static_cast<uint8_t>(adler >> 16));
+	strips.back().push_back(static_cast<uint8_t>(adler >> 8));
+	strips.back().push_back(static_cast<uint8_t>(adler));
+
+	for (int s = 0; s < numStrips; s++) {
+		if (s == 0) {
+			writeChunk(file, "IDAT", zlibHeaderBytes, 2, strips[s].data(), strips[s].size());
+		} else {
+			writeChunk(file, "IDAT", strips[s].data(), strips[s].size());
+		}
+	}
+
+	writeChunk(file, "IEND", nullptr, 0);
+	file.close();
+	return !file.fail();
+}
+
+#else
+
+bool PngWriter::isAvailable()
+{
+	return false;
+}
+
+bool PngWriter::write(const std::string &filename, const uint32_t *pixels, int width, int height, int stride32) const
+{
+	(void)filename;
+	(void)pixels;
+	(void)width;
+	(void)height;
+	(void)stride32;
+	return false;
+}
+
+#endif // SNDSPEC_ZLIB
+
+void PngWriter::setCompressionLevel(int value)
+{
+	compressionLevel = std::max(0, std::min(9, value));
+}
+
+void PngWriter::setNumThreads(int value)
+{
+	numThreads = std::max(1, value);
+}
+
+} // namespace Sndspec
@@ -0,0 +1,69 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <cstdint>
+#include <string>
+
+namespace Sndspec {
+
+// class PngWriter : writes images (of 32-bit pixels, in cairo's RGB24 format) to PNG files, using a number of threads.
+// The rows are filtered in parallel, and then the image is divided into strips of rows, which are deflated in parallel.
+// Each strip is a separate piece of one zlib stream, which is primed with the end of the previous strip (as a preset dictionary),
+// so that the compression is almost as good as deflating the whole image at once.
+// The strips are a fixed size, so the output doesn't depend on the number of threads.
+// In indexed mode, images with no more than 256 distinct colors are written as 8-bit palette images
+// (which are a lot smaller, and faster to write, than 24-bit RGB images). Other images are still written as RGB.
+// (PngWriter requires zlib : see isAvailable())
+
+class PngWriter
+{
+public:
+	// isAvailable() : returns true if sndspec was built with zlib. Otherwise, write() always fails
+	static bool isAvailable();
+
+	// write() : write the image to a PNG file. stride32 is the distance between rows, in pixels. Returns true on success
+	bool write(const std::string& filename, const uint32_t* pixels, int width, int height, int stride32) const;
+
+	int getCompressionLevel() const
+	{
+		return compressionLevel;
+	}
+
+	// setCompressionLevel() : 0 (none, fastest) to 9 (smallest)
+	void setCompressionLevel(int value);
+
+	bool getIndexed() const
+	{
+		return indexed;
+	}
+
+	void setIndexed(bool value)
+	{
+		indexed = value;
+	}
+
+	int getNumThreads() const
+	{
+		return numThreads;
+	}
+
+	void setNumThreads(int value);
+
+private:
+	int compressionLevel{6};
+	int numThreads{1};
+	bool indexed{false};
+};
+
+} // namespace Sndspec
+
+#endif // PNGWRITER_H
@@ -16,33 +16,38 @@
 
 // class RaiiTimer : starts a high-resolution timer upon construction and prints elapsed time to stdout upon destruction
 // For convenience, a reference time value (in ms) for comparison may be provided using the parameter msComparison.
+// Output may be directed to a stream other than stdout by providing the parameter out.
 
 namespace SndSpec {
 
 class RaiiTimer
 {
 public:
-	explicit RaiiTimer(double msComparison = 0.0) : msComparison(msComparison) {
+	explicit RaiiTimer(double msComparison = 0.0, std::ostream& out = std::cout) : msComparison(msComparison), out(out) {
 		beginTimer = std::chrono::high_resolution_clock::now();
 	}
 
+	explicit RaiiTimer(std::ostream& out) : RaiiTimer(0.0, out) {
+	}
+
 	~RaiiTimer() {
 		endTimer = std::chrono::high_resolution_clock::now();
 		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTimer - beginTimer).count();
-		std::cout << " Time=" << std::setprecision(5) << 0.001 * duration << " ms";
+		out << " Time=" << std::setprecision(5) << 0.001 * duration << " ms";
 		if (msComparison != 0.0) {
 			double relativeSpeed = msComparison / duration;
-			auto ss = std::cout.precision();
-			std::cout << " [" << std::setprecision(1) << relativeSpeed << "x]" << std::setprecision(
+			auto ss = out.precision();
+			out << " [" << std::setprecision(1) << relativeSpeed << "x]" << std::setprecision(
 							 static_cast<int>(ss));
 		}
-		std::cout << "\n" << std::endl;
+		out << "\n" << std::endl;
 	}
 
 private:
 	std::chrono::time_point<std::chrono::high_resolution_clock> beginTimer;
 	std::chrono::time_point<std::chrono::high_resolution_clock> endTimer;
 	double msComparison;
+	std::ostream& out;
 };
 
 } // namespace SndSpec
@@ -0,0 +1,246 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Sndspec {
+
+// class ReadAhead : decodes blocks on a separate (decoder) thread, ahead of the threads which analyze them.
+// The decoder thread reads, windows and deinterleaves blocks into a fixed pool of buffers, and queues them (in order) for the consumers.
+// When every buffer in the pool is in use, the decoder waits for a consumer to release one,
+// so the memory used is bounded by the size of the pool, no matter how far the decoder is ahead of the consumers.
+// The time spent waiting on each side is recorded, which shows whether decoding or analysis is the bottleneck.
+
+template <typename T>
+class ReadAhead
+{
+public:
+	// Block : one block of (deinterleaved) channel data
+	struct Block
+	{
+		int x{0}; // block position
+		std::vector<T> data; // numOutputs channels, each of blockSize samples
+
+		const T* channel(int ch, int blockSize) const
+		{
+			return data.data() + static_cast<size_t>(ch) * blockSize;
+		}
+	};
+
+	// reader : a reader (with its window, time range etc already set) for the exclusive use of the decoder thread
+	// depth : number of blocks in the pool
+	ReadAhead(Reader<T>& reader, int depth)
+		: reader(reader), pool(std::max(2, depth))
+	{
+	}
+
+	~ReadAhead()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cancelled = true;
+		}
+		condition.notify_all();
+		if (decoder.joinable()) {
+			decoder.join();
+		}
+	}
+
+	ReadAhead(const ReadAhead&) = delete;
+	ReadAhead& operator=(const ReadAhead&) = delete;
+
+	// start() : start decoding blocks [xBegin, xEnd) in the given mode
+	void start(int xBegin, int xEnd, DeinterleaveMode mode)
+	{
+		numOutputs = (mode == DeinterleaveNormal) ? reader.getNChannels() : 1;
+		for (Block& block : pool) {
+			block.data.resize(static_cast<size_t>(numOutputs) * reader.getBlockSize());
+			freeBlocks.push_back(&block);
+		}
+
+		decoder = std::thread([this, xBegin, xEnd, mode]() {
+			decode(xBegin, xEnd, mode);
+		});
+	}
+
+	// pop() : take the next block from the queue (waiting if necessary). Returns nullptr when there are no more blocks
+	Block* pop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (queue.empty() && !finished) {
+			const auto t0 = std::chrono::steady_clock::now();
+			condition.wait(lock, [this]() {
+				return !queue.empty() || finished;
+			});
+			consumerStallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		}
+
+		if (queue.empty()) {
+			return nullptr;
+		}
+
+		Block* block = queue.front();
+		queue.pop_front();
+		return block;
+	}
+
+	// release() : return a block (obtained from pop()) to the pool
+	void release(Block* block)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeBlocks.push_back(block);
+		}
+		condition.notify_all();
+	}
+
+	int getNumOutputs() const
+	{
+		return numOutputs;
+	}
+
+	int getDepth() const
+	{
+		return static_cast<int>(pool.size());
+	}
+
+	// statistics (complete once pop() has returned nullptr)
+
+	// getAverageQueueLength() : average number of blocks waiting in the queue, sampled each time a block is queued
+	double getAverageQueueLength() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return (numQueued == 0) ? 0.0 : static_cast<double>(totalQueueLength) / numQueued;
+	}
+
+	// getDecoderStallTime() : total time (in seconds) the decoder spent waiting for a free block
+	double getDecoderStallTime() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return decoderStallTime;
+	}
+
+	// getConsumerStallTime() : total time (in seconds) the consumers spent waiting for a block (summed over all consumers)
+	double getConsumerStallTime() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return consumerStallTime;
+	}
+
+private:
+	Reader<T>& reader;
+	std::vector<Block> pool;
+	std::deque<Block*> freeBlocks;
+	std::deque<Block*> queue;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+	std::thread decoder;
+	int numOutputs{0};
+	bool finished{false};
+	bool cancelled{false};
+
+	// statistics
+	int64_t numQueued{0};
+	int64_t totalQueueLength{0};
+	double decoderStallTime{0.0};
+	double consumerStallTime{0.0};
+
+	// acquire() : take a block from the pool (waiting if necessary). Returns nullptr if cancelled
+	Block* acquire()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (freeBlocks.empty() && !cancelled) {
+			const auto t0 = std::chrono::steady_clock::now();
+			condition.wait(lock, [this]() {
+				return !freeBlocks.empty() || cancelled;
+			});
+			decoderStallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		}
+
+		if (cancelled) {
+			return nullptr;
+		}
+
+		Block* block = freeBlocks.front();
+		freeBlocks.pop_front();
+		return block;
+	}
+
+	void setOutputs(Block* block)
+	{
+		for (int ch = 0; ch < reader.getNChannels(); ch++) {
+			// (in sum / difference modes, only the first channel buffer is used)
+			reader.setChannelBuffer(ch, ch < numOutputs ? block->data.data() + static_cast<size_t>(ch) * reader.getBlockSize() : nullptr);
+		}
+	}
+
+	void decode(int xBegin, int xEnd, DeinterleaveMode mode)
+	{
+		Block* current = acquire();
+		if (current != nullptr) {
+			setOutputs(current);
+
+			// when all of the outputs of a block have been written, queue it, and direct the reader to the next free block.
+			// (once cancelled, the remaining blocks are decoded into the current block, and discarded)
+			reader.setProcessingFunc([this, &current](int pos, int channel, const T* data) -> void {
+				(void)data;
+				if (channel != numOutputs - 1) {
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (cancelled) {
+						return;
+					}
+					current->x = pos;
+					queue.push_back(current);
+					totalQueueLength += static_cast<int64_t>(queue.size());
+					numQueued++;
+				}
+				condition.notify_all();
+
+				Block* next = acquire();
+				if (next != nullptr) {
+					current = next;
+					setOutputs(current);
+				}
+			});
+
+			if (mode == DeinterleaveSum) {
+				reader.readSum(xBegin, xEnd);
+			} else if (mode == DeinterleaveDifference) {
+				reader.readDifference(xBegin, xEnd);
+			} else {
+				reader.readDeinterleaved(xBegin, xEnd);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished = true;
+		}
+		condition.notify_all();
+	}
+};
+
+} // namespace Sndspec
+
+#endif // READAHEAD_H
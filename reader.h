@@ -11,15 +11,22 @@
 #define READER_H
 
 #include <iostream>
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <array>
 #include <vector>
 #include <string>
 #include <memory>
 #include <cmath>
+#include <tuple>
+#include <type_traits>
 
 #include <sndfile.hh>
 
+#include "deinterleave.h"
+#include "mappedaudiofile.h"
+
 namespace Sndspec {
 
 template <typename T>
@@ -39,6 +46,30 @@ public:
 			nFrames = sndFileHandle->frames();
 			channelBuffers.resize(nChannels, nullptr);
 
+			// uncompressed files are read directly from a memory mapping, where possible (libsndfile is still used for everything else)
+			mapped = std::make_unique<MappedAudioFile>();
+			if (mapped->open(Reader::filename) && mapped->getChannels() == nChannels && mapped->getSamplerate() == samplerate && mapped->getNFrames() == nFrames) {
+				sampleEncoding = mapped->getEncoding();
+			} else {
+				mapped.reset();
+
+				// integer PCM is read as integers, and converted by the deinterleave kernels (rather than by libsndfile, in a separate pass)
+				switch (sndFileHandle->format() & SF_FORMAT_SUBMASK) {
+				case SF_FORMAT_PCM_S8:
+				case SF_FORMAT_PCM_U8:
+				case SF_FORMAT_PCM_16:
+					sampleEncoding = MappedAudioFile::EncodingInt16;
+					break;
+				case SF_FORMAT_PCM_24:
+				case SF_FORMAT_PCM_32:
+					sampleEncoding = MappedAudioFile::EncodingInt32;
+					break;
+				default:
+					sampleEncoding = std::is_same<T, float>::value ? MappedAudioFile::EncodingFloat : MappedAudioFile::EncodingDouble;
+				}
+			}
+			initSource();
+
 			// placeholder function
 			processingFunc = [](int pos, int ch, const T* data) -> void {
 				(void)data; // unused
@@ -75,147 +106,53 @@ public:
 
 	void readSum()
 	{
-		if (!window.empty() && window.size() != blockSize) { // incorrect window size
-			return;
-		}
-
-		std::vector<T> inputBuffer(nChannels * blockSize);
-
-		int64_t startFrame = startPos;
-		for (int x = 0; x < w; x++) {
-
-			sndFileHandle->seek(startFrame, SEEK_SET);
-			int64_t framesRead = sndFileHandle->readf(inputBuffer.data(), blockSize);
-
-			if (framesRead < blockSize) {
-				// pad with trailing zeroes
-				for (size_t i = static_cast<size_t>(framesRead); i < inputBuffer.size(); i++) {
-					inputBuffer[i] = 0.0;
-				}
-			}
-
-			// deinterleave
-			const T* p = inputBuffer.data();
-			if (window.empty()) {
-				for (int64_t f = 0; f < framesRead; f++) {
-					for (int ch = 0; ch < nChannels; ch++) {
-						channelBuffers[ch][f] = 0.0; // clear
-						channelBuffers[0][f] += *p++; // sum
-					}
-				}
-			} else {
-				for (int64_t f = 0; f < framesRead; f++) {
-					for (int ch = 0; ch < nChannels; ch++) {
-						channelBuffers[ch][f] = 0.0; // clear
-						channelBuffers[0][f] += *p++; // sum
-					}
-					channelBuffers[0][f] *= window[f]; // apply window
-				}
-			}
-
-			// call processing function
-			processingFunc(x, 0, channelBuffers.at(0));  // only one output buffer is used : channelBuffers[0]
+		readSum(0, w);
+	}
 
-			// advance
-			startFrame += interval;
-		}
+	// readSum(xBegin, xEnd) : read and process only the blocks at positions [xBegin, xEnd)
+	void readSum(int xBegin, int xEnd)
+	{
+		read(xBegin, xEnd, DeinterleaveSum);
 	}
 
 	void readDifference()
 	{
-		if (!window.empty() && window.size() != blockSize) { // incorrect window size
-			return;
-		}
-
-		std::vector<T> inputBuffer(nChannels * blockSize);
-
-		int64_t startFrame = startPos;
-		for (int x = 0; x < w; x++) {
-
-			sndFileHandle->seek(startFrame, SEEK_SET);
-			int64_t framesRead = sndFileHandle->readf(inputBuffer.data(), blockSize);
-
-			if (framesRead < blockSize) {
-				// pad with trailing zeroes
-				for (size_t i = static_cast<size_t>(framesRead); i < inputBuffer.size(); i++) {
-					inputBuffer[i] = 0.0;
-				}
-			}
-
-			// deinterleave
-			const T* p = inputBuffer.data();
-			if (window.empty()) {
-				for (int64_t f = 0; f < framesRead; f++) {
-					channelBuffers[0][f] = *p++;
-					for (int ch = 1; ch < nChannels; ch++) {
-						channelBuffers[ch][f] = 0.0; // clear
-						channelBuffers[0][f] -= *p++; // subtract
-					}
-				}
-			} else {
-				for (int64_t f = 0; f < framesRead; f++) {
-					channelBuffers[0][f] = *p++;
-					for (int ch = 1; ch < nChannels; ch++) {
-						channelBuffers[ch][f] = 0.0; // clear
-						channelBuffers[0][f] -= *p++; // subtract
-					}
-					channelBuffers[0][f] *= window[f]; // apply window
-				}
-			}
-
-			// call processing function
-			processingFunc(x, 0, channelBuffers.at(0));  // only one output buffer is used : channelBuffers[0]
+		readDifference(0, w);
+	}
 
-			// advance
-			startFrame += interval;
-		}
+	// readDifference(xBegin, xEnd) : read and process only the blocks at positions [xBegin, xEnd)
+	void readDifference(int xBegin, int xEnd)
+	{
+		read(xBegin, xEnd, DeinterleaveDifference);
 	}
 
 	void readDeinterleaved()
 	{
-		if (!window.empty() && window.size() != blockSize) { // incorrect window size
-			return;
-		}
-
-		std::vector<T> inputBuffer(nChannels * blockSize);
-
-		int64_t startFrame = startPos;
-		for (int x = 0; x < w; x++) {
-
-			sndFileHandle->seek(startFrame, SEEK_SET);
-			int64_t framesRead = sndFileHandle->readf(inputBuffer.data(), blockSize);
+		readDeinterleaved(0, w);
+	}
 
-			if (framesRead < blockSize) {
-				// pad with trailing zeroes
-				for (size_t i = static_cast<size_t>(framesRead); i < inputBuffer.size(); i++) {
-					inputBuffer[i] = 0.0;
-				}
-			}
+	// readDeinterleaved(xBegin, xEnd) : read and process only the blocks at positions [xBegin, xEnd)
+	void readDeinterleaved(int xBegin, int xEnd)
+	{
+		read(xBegin, xEnd, DeinterleaveNormal);
+	}
 
-			// deinterleave
-			const T* p = inputBuffer.data();
-			if (window.empty()) {
-				for (int64_t f = 0; f < framesRead; f++) {
-					for (int ch = 0; ch < nChannels; ch++) {
-						channelBuffers[ch][f] = *p++;
-					}
-				}
-			} else {
-				for (int64_t f = 0; f < framesRead; f++) {
-					for (int ch = 0; ch < nChannels; ch++) {
-						channelBuffers[ch][f] = *p++ * window[f];
-					}
-				}
-			}
+	bool getStreaming() const
+	{
+		return streaming;
+	}
 
-			// call processing function
-			for (int ch = 0; ch < nChannels; ch++) {
-				processingFunc(x, ch, channelBuffers.at(ch));
-			}
+	// setStreaming() : when streaming is enabled, the file is decoded sequentially into a ring buffer (instead of seeking to each block),
+	// so that each frame in the selected range is decoded exactly once, even if blocks overlap.
+	// This is much faster for compressed formats (such as flac and ogg), where every seek restarts the decoder.
+	void setStreaming(bool value)
+	{
+		streaming = value;
+	}
 
-			// advance
-			startFrame += interval;
-		}
+	int64_t getInterval() const
+	{
+		return interval;
 	}
 
 	std::vector<T> getWindow() const
@@ -253,16 +190,21 @@ public:
 		samplerate = value;
 	}
 
-	int getNFrames() const
+	int64_t getNFrames() const
 	{
 		return nFrames;
 	}
 
-	void setNFrames(int value)
+	void setNFrames(int64_t value)
 	{
 		nFrames = value;
 	}
 
+	int getW() const
+	{
+		return w;
+	}
+
 	int getBlockSize() const
 	{
 		return blockSize;
@@ -276,9 +218,9 @@ private:
 	std::string filename;
 	ProcessingFunc processingFunc;
 	int blockSize;
-	int64_t startPos;
-	int64_t finishPos;
-	int64_t interval;
+	int64_t startPos{0};
+	int64_t finishPos{0};
+	int64_t interval{0};
 	int w;
 	std::unique_ptr<SndfileHandle> sndFileHandle;
 	int nChannels;
@@ -286,6 +228,283 @@ private:
 	int64_t nFrames;
 	std::vector<T> window;
 	std::vector<T*> channelBuffers;
+
+	std::unique_ptr<MappedAudioFile> mapped; // (nullptr if the file is read with libsndfile)
+	MappedAudioFile::Encoding sampleEncoding{MappedAudioFile::EncodingDouble}; // type of the samples in the mapping, or requested from libsndfile
+
+	// Source<S> : buffers and deinterleave kernels for samples of type S
+	template <typename S>
+	struct Source
+	{
+		std::vector<S> inputBuffer;
+		std::vector<S> ringBuffer; // holds (up to) one block of interleaved frames (streaming only)
+		std::array<typename Deinterleaver<T, S>::Kernel, 3> kernels{}; // indexed by DeinterleaveMode
+		T scale{1.0};
+	};
+
+	// (only the Source corresponding to sampleEncoding is used)
+	std::tuple<Source<short>, Source<int>, Source<float>, Source<double>,
+		Source<PackedInt24>, Source<PackedInt16BE>, Source<PackedInt24BE>, Source<PackedInt32BE>> sources;
+
+	// streaming state
+	bool streaming{false};
+	int64_t ringStartFrame{0}; // file position of the oldest frame in the ring buffer
+	int64_t ringFrames{0}; // number of frames currently in the ring buffer
+	int64_t ringHead{0}; // ring buffer position (in frames) of the oldest frame
+	int nextX{-1}; // block position which would continue the current stream (-1 if no stream is in progress)
+
+	template <typename S>
+	Source<S>& getSource()
+	{
+		return std::get<Source<S>>(sources);
+	}
+
+	// initSource() : choose the deinterleave kernels for the type of sample and number of channels
+	void initSource()
+	{
+		switch (sampleEncoding) {
+		case MappedAudioFile::EncodingInt16:
+			initSource<short>(1.0 / 0x8000);
+			break;
+		case MappedAudioFile::EncodingInt32:
+			initSource<int>(1.0 / 0x80000000);
+			break;
+		case MappedAudioFile::EncodingFloat:
+			initSource<float>(1.0);
+			break;
+		case MappedAudioFile::EncodingInt24:
+			initSource<PackedInt24>(1.0 / 0x80000000);
+			break;
+		case MappedAudioFile::EncodingInt16BE:
+			initSource<PackedInt16BE>(1.0 / 0x80000000);
+			break;
+		case MappedAudioFile::EncodingInt24BE:
+			initSource<PackedInt24BE>(1.0 / 0x80000000);
+			break;
+		case MappedAudioFile::EncodingInt32BE:
+			initSource<PackedInt32BE>(1.0 / 0x80000000);
+			break;
+		default:
+			initSource<double>(1.0);
+		}
+	}
+
+	template <typename S>
+	void initSource(T scale)
+	{
+		Source<S>& source = getSource<S>();
+		for (DeinterleaveMode mode : {DeinterleaveNormal, DeinterleaveSum, DeinterleaveDifference}) {
+			source.kernels[mode] = Deinterleaver<T, S>::getKernel(mode, nChannels);
+		}
+		source.scale = scale;
+	}
+
+	void read(int xBegin, int xEnd, DeinterleaveMode mode)
+	{
+		if (!window.empty() && window.size() != static_cast<size_t>(blockSize)) { // incorrect window size
+			return;
+		}
+
+		switch (sampleEncoding) {
+		case MappedAudioFile::EncodingInt16:
+			read<short>(xBegin, xEnd, mode);
+			break;
+		case MappedAudioFile::EncodingInt32:
+			read<int>(xBegin, xEnd, mode);
+			break;
+		case MappedAudioFile::EncodingFloat:
+			read<float>(xBegin, xEnd, mode);
+			break;
+		case MappedAudioFile::EncodingInt24:
+			read<PackedInt24>(xBegin, xEnd, mode);
+			break;
+		case MappedAudioFile::EncodingInt16BE:
+			read<PackedInt16BE>(xBegin, xEnd, mode);
+			break;
+		case MappedAudioFile::EncodingInt24BE:
+			read<PackedInt24BE>(xBegin, xEnd, mode);
+			break;
+		case MappedAudioFile::EncodingInt32BE:
+			read<PackedInt32BE>(xBegin, xEnd, mode);
+			break;
+		default:
+			read<double>(xBegin, xEnd, mode);
+		}
+	}
+
+	template <typename S>
+	void read(int xBegin, int xEnd, DeinterleaveMode mode)
+	{
+		if (mapped != nullptr) {
+			readMapped<S>(xBegin, xEnd, mode);
+		} else if constexpr (std::is_same<S, short>::value || std::is_same<S, int>::value || std::is_same<S, T>::value) {
+			readSndfile<S>(xBegin, xEnd, mode);
+		}
+	}
+
+	// readMapped() : read blocks directly from the memory mapping
+	template <typename S>
+	void readMapped(int xBegin, int xEnd, DeinterleaveMode mode)
+	{
+		Source<S>& source = getSource<S>();
+		const S* frames = static_cast<const S*>(mapped->getFrames());
+		int64_t startFrame = startPos + xBegin * interval;
+
+		// when the blocks are close together, the whole range is read in order. Otherwise, each block is requested ahead of time
+		const bool sequential = (interval <= 2 * static_cast<int64_t>(blockSize));
+		if (sequential) {
+			mapped->advise(startFrame, (xEnd - xBegin) * interval + blockSize, MappedFile::AdviceSequential);
+		}
+
+		for (int x = xBegin; x < xEnd; x++) {
+			if (!sequential) {
+				mapped->advise(startFrame + interval, blockSize, MappedFile::AdviceWillNeed);
+			}
+
+			const int64_t available = std::max(INT64_C(0), std::min(static_cast<int64_t>(blockSize), mapped->getNFrames() - startFrame));
+			if (available == blockSize) {
+				deinterleave(source, frames + startFrame * nChannels, 0, blockSize, mode);
+			} else {
+				// end of file: copy the remaining frames, and pad with trailing zeroes
+				std::vector<S>& inputBuffer = source.inputBuffer;
+				inputBuffer.assign(nChannels * blockSize, S{});
+				if (available > 0) {
+					std::copy(frames + startFrame * nChannels, frames + (startFrame + available) * nChannels, inputBuffer.begin());
+				}
+				deinterleave(source, inputBuffer.data(), 0, blockSize, mode);
+			}
+
+			process(x, mode);
+			startFrame += interval;
+		}
+	}
+
+	// readSndfile() : read blocks using libsndfile
+	template <typename S>
+	void readSndfile(int xBegin, int xEnd, DeinterleaveMode mode)
+	{
+		Source<S>& source = getSource<S>();
+		std::vector<S>& ringBuffer = source.ringBuffer;
+		std::vector<S>& inputBuffer = source.inputBuffer;
+
+		if (streaming && (xBegin != nextX || ringBuffer.size() != static_cast<size_t>(nChannels * blockSize))) {
+			// start a new stream
+			ringBuffer.assign(nChannels * blockSize, S{0});
+			ringStartFrame = startPos + xBegin * interval;
+			ringFrames = 0;
+			ringHead = 0;
+			sndFileHandle->seek(ringStartFrame, SEEK_SET);
+		} else if (!streaming) {
+			inputBuffer.resize(nChannels * blockSize);
+		}
+
+		int64_t startFrame = startPos + xBegin * interval;
+		for (int x = xBegin; x < xEnd; x++) {
+
+			if (streaming) {
+				fetchStreamed<S>(startFrame);
+
+				// the block may wrap around the end of the ring buffer: deinterleave it as two spans
+				const int64_t span0 = std::min(static_cast<int64_t>(blockSize), blockSize - ringHead);
+				deinterleave(source, ringBuffer.data() + ringHead * nChannels, 0, span0, mode);
+				deinterleave(source, ringBuffer.data(), span0, blockSize, mode);
+			} else {
+				fetchSeek<S>(startFrame);
+				deinterleave(source, inputBuffer.data(), 0, blockSize, mode);
+			}
+
+			process(x, mode);
+
+			// advance
+			startFrame += interval;
+		}
+
+		nextX = xEnd;
+	}
+
+	// process() : call processing function for block x
+	void process(int x, DeinterleaveMode mode)
+	{
+		if (mode == DeinterleaveNormal) {
+			for (int ch = 0; ch < nChannels; ch++) {
+				processingFunc(x, ch, channelBuffers.at(ch));
+			}
+		} else {
+			processingFunc(x, 0, channelBuffers.at(0));  // only one output buffer is used : channelBuffers[0]
+		}
+	}
+
+	// fetchSeek() : seek to startFrame, and read one block into inputBuffer
+	template <typename S>
+	void fetchSeek(int64_t startFrame)
+	{
+		std::vector<S>& inputBuffer = getSource<S>().inputBuffer;
+		sndFileHandle->seek(startFrame, SEEK_SET);
+		int64_t framesRead = std::max(INT64_C(0), static_cast<int64_t>(sndFileHandle->readf(inputBuffer.data(), blockSize)));
+
+		if (framesRead < blockSize) {
+			// pad with trailing zeroes
+			std::fill(inputBuffer.begin() + framesRead * nChannels, inputBuffer.end(), S{0});
+		}
+	}
+
+	// fetchStreamed() : bring the ring buffer up to date, so that it contains the block beginning at startFrame.
+	// Frames which are still in the ring buffer (due to overlapping blocks) are not decoded again,
+	// and frames between blocks are decoded and discarded, rather than seeked over.
+	template <typename S>
+	void fetchStreamed(int64_t startFrame)
+	{
+		std::vector<S>& ringBuffer = getSource<S>().ringBuffer;
+		const int64_t ringEndFrame = ringStartFrame + ringFrames; // next frame to be decoded
+		if (startFrame >= ringEndFrame) {
+			// no overlap with previous block: skip over the gap
+			skipFrames<S>(startFrame - ringEndFrame);
+			ringStartFrame = startFrame;
+			ringFrames = 0;
+			ringHead = 0;
+		} else {
+			// drop frames preceding startFrame
+			const int64_t drop = startFrame - ringStartFrame;
+			ringStartFrame = startFrame;
+			ringFrames -= drop;
+			ringHead = (ringHead + drop) % blockSize;
+		}
+
+		// decode remainder of block into the free part of the ring buffer (which may wrap around)
+		while (ringFrames < blockSize) {
+			const int64_t tail = (ringHead + ringFrames) % blockSize;
+			const int64_t count = std::min(blockSize - ringFrames, blockSize - tail);
+			S* p = ringBuffer.data() + tail * nChannels;
+			int64_t framesRead = std::max(INT64_C(0), static_cast<int64_t>(sndFileHandle->readf(p, count)));
+			if (framesRead < count) {
+				// end of file: pad with trailing zeroes
+				std::fill(p + framesRead * nChannels, p + count * nChannels, S{0});
+			}
+			ringFrames += count;
+		}
+	}
+
+	// skipFrames() : decode and discard the given number of frames
+	template <typename S>
+	void skipFrames(int64_t frames)
+	{
+		std::vector<S>& inputBuffer = getSource<S>().inputBuffer;
+		inputBuffer.resize(nChannels * blockSize);
+		while (frames > 0) {
+			const int64_t count = std::min(frames, static_cast<int64_t>(blockSize));
+			if (sndFileHandle->readf(inputBuffer.data(), count) < count) {
+				return; // end of file
+			}
+			frames -= count;
+		}
+	}
+
+	// deinterleave() : deinterleave (and window) frames [fBegin, fEnd) of the current block, taking input from p
+	template <typename S>
+	void deinterleave(const Source<S>& source, const S* p, int64_t fBegin, int64_t fEnd, DeinterleaveMode mode)
+	{
+		source.kernels[mode](p, channelBuffers.data(), window.empty() ? nullptr : window.data(), fBegin, fEnd, nChannels, source.scale);
+	}
 };
 
 } // namespace Sndspec
@@ -8,6 +8,8 @@
 */
 
 #include "renderer.h"
+#include "batch.h"
+#include "palettethresholds.h"
 
 #include <cstdlib>
 #include <cstddef>
@@ -43,37 +45,175 @@ Renderer::~Renderer()
 	cairo_surface_destroy(surface);
 }
 
-void Renderer::renderSpectrogram(const Parameters &parameters, const SpectrogramResults<double> &spectrogramData)
+template <typename FloatType>
+void Renderer::renderSpectrogram(const Parameters &parameters, const SpectrogramResults<FloatType> &spectrogramData)
 {
-	const int numChannels = spectrogramData.size();
-	resolveEnabledChannels(parameters, numChannels);
+	resolveEnabledChannels(parameters, spectrogramData.getNumChannels());
+	panes = layoutPanes(parameters.getChannelLayout());
+
+	const double colorScale = heatMapPalette.size() / -parameters.getDynRange();
+	const int lastColorIndex = std::max(0, static_cast<int>(heatMapPalette.size()) - 1);
+
+	plotSpectrogram(spectrogramData, [colorScale, lastColorIndex](int /* channel */) {
+		return [colorScale, lastColorIndex](FloatType v) -> int {
+			return std::max(0, std::min(static_cast<int>(v * colorScale), lastColorIndex));
+		};
+	});
+
+	drawSpectrogramDecorations(parameters);
+}
+
+template <typename FloatType>
+void Renderer::renderSpectrogramFromMagSquared(const Parameters &parameters, const SpectrogramResults<FloatType> &magSquaredData, const std::vector<double> &peaks)
+{
+	resolveEnabledChannels(parameters, magSquaredData.getNumChannels());
+	panes = layoutPanes(parameters.getChannelLayout());
 
-	const int numSpectrums = spectrogramData.at(0).size();
-	const int numBins = spectrogramData.at(0).at(0).size();
+	const int numColors = static_cast<int>(heatMapPalette.size());
+	const double dynRange = parameters.getDynRange();
+
+	plotSpectrogram(magSquaredData, [numColors, dynRange, &peaks](int channel) {
+		return [thresholds = PaletteThresholds<FloatType>(numColors, dynRange, peaks.at(channel), /* fromMagSquared = */ true)](FloatType v) -> int {
+			return thresholds.getIndex(v);
+		};
+	});
+
+	drawSpectrogramDecorations(parameters);
+}
+
+template <typename FloatType, typename MakeIndexFunc>
+void Renderer::plotSpectrogram(const SpectrogramResults<FloatType> &spectrogramData, MakeIndexFunc makeIndexFunc)
+{
+	const int numChannels = spectrogramData.getNumChannels();
+	const int numSpectrums = spectrogramData.getNumColumns();
+	const int numBins = spectrogramData.getNumBins();
+	const ptrdiff_t columnStride = spectrogramData.getColumnStride();
 	const int h = plotHeight - 2;
-	double colorScale = heatMapPalette.size() / -parameters.getDynRange();
-	int lastColorIndex = std::max(0, static_cast<int>(heatMapPalette.size()) - 1);
-	windowFunctionLabel = "Window: " + parameters.getWindowFunctionDisplayName();
-	showWindowFunctionLabel = parameters.getShowWindowFunctionLabel();
+
+	// Pixels are written row-by-row. For bin-major data, rows of the data are contiguous and can be walked in one pass.
+	// For column-major data, walk the data in tiles of columns, so that the cache lines of each column are re-used from one row to the next
+	const int tileWidth = (spectrogramData.getLayout() == SpectrogramResults<FloatType>::BinMajor) ? std::max(1, numSpectrums) : 64;
+
+	if (!panes.empty()) {
+		// plot each pane into its own indexed area (in parallel)
+		const size_t firstArea = indexedAreas.size();
+		for (const Pane& pane : panes) {
+			addIndexedArea(pane.x, pane.y, pane.width, pane.height);
+		}
+
+		const int maxIndex = std::max(0, static_cast<int>(heatMapPalette.size()) - 1);
+		runWorkStealing(static_cast<int64_t>(panes.size()), numThreads, 1, [&](int t, int64_t pBegin, int64_t pEnd) {
+			(void)t;
+			for (int64_t p = pBegin; p < pEnd; p++) {
+				const int c = panes.at(p).channel;
+				plotPane(spectrogramData, c, makeIndexFunc(c), maxIndex, indexedAreas.at(firstArea + p));
+			}
+		});
+		return;
+	}
 
 	for (int c = 0; c < numChannels; c++) {
 		if (channelsEnabled.at(c)) {
 			// plot just one, then break
-			for (int y = 0; y < numBins; y++) {
-				int lineAddr = plotOriginX + (plotOriginY + h - y) * stride32;
-				for (int x = 0; x < numSpectrums; x++) {
-					int colorindex = static_cast<int>(spectrogramData[c][x][y] * colorScale);
-					int32_t color = heatMapPalette[std::max(0, std::min(colorindex, lastColorIndex))];
-					pixelBuffer[x + lineAddr] = color;
+			if (numSpectrums != plotWidth || numBins > plotHeight) {
+				// the data was analyzed for a larger plot (see --rendition) : pool it down to fit the plot area
+				plotPane(spectrogramData, c, makeIndexFunc(c), std::max(0, static_cast<int>(heatMapPalette.size()) - 1),
+						 addIndexedArea(plotOriginX, plotOriginY, plotWidth, plotHeight - 1));
+				break;
+			}
+
+			IndexedArea& area = addIndexedArea(plotOriginX, plotOriginY + h - (numBins - 1), numSpectrums, numBins);
+			const auto getIndex = makeIndexFunc(c);
+			for (int x0 = 0; x0 < numSpectrums; x0 += tileWidth) {
+				const int x1 = std::min(numSpectrums, x0 + tileWidth);
+				for (int y = 0; y < numBins; y++) {
+					uint8_t* line = area.indices.data() + static_cast<size_t>(numBins - 1 - y) * numSpectrums;
+					const FloatType* row = spectrogramData.row(c, y);
+					for (int x = x0; x < x1; x++) {
+						line[x] = static_cast<uint8_t>(getIndex(row[x * columnStride]));
+					}
 				}
 			}
 			break;
 		}
 	}
+}
+
+template <typename FloatType, typename GetIndexFunc>
+void Renderer::plotPane(const SpectrogramResults<FloatType> &spectrogramData, int channel, GetIndexFunc getIndex, int maxIndex, IndexedArea &area)
+{
+	const int numSpectrums = spectrogramData.getNumColumns();
+	const int numBins = spectrogramData.getNumBins();
+	const ptrdiff_t columnStride = spectrogramData.getColumnStride();
+	if (numSpectrums == 0 || numBins == 0) {
+		return;
+	}
+
+	// the columns which fall into each pixel column : [columnBegin[px], columnEnd[px])
+	std::vector<int> columnBegin(area.width);
+	std::vector<int> columnEnd(area.width);
+	for (int px = 0; px < area.width; px++) {
+		columnBegin[px] = static_cast<int>(static_cast<int64_t>(px) * numSpectrums / area.width);
+		columnEnd[px] = std::max(columnBegin[px] + 1, static_cast<int>(static_cast<int64_t>(px + 1) * numSpectrums / area.width));
+	}
+
+	std::fill(area.indices.begin(), area.indices.end(), static_cast<uint8_t>(maxIndex));
+	for (int py = 0; py < area.height; py++) {
+		// (lowest frequencies at the bottom)
+		const int r = area.height - 1 - py;
+		const int binBegin = static_cast<int>(static_cast<int64_t>(r) * numBins / area.height);
+		const int binEnd = std::max(binBegin + 1, static_cast<int>(static_cast<int64_t>(r + 1) * numBins / area.height));
+		uint8_t* line = area.indices.data() + static_cast<size_t>(py) * area.width;
+		for (int b = binBegin; b < binEnd; b++) {
+			const FloatType* row = spectrogramData.row(channel, b);
+			for (int px = 0; px < area.width; px++) {
+				int index = line[px];
+				for (int x = columnBegin[px]; x < columnEnd[px]; x++) {
+					index = std::min(index, getIndex(row[x * columnStride]));
+				}
+				line[px] = static_cast<uint8_t>(index);
+			}
+		}
+	}
+}
+
+// explicit instantiations
+template void Renderer::renderSpectrogram(const Parameters &parameters, const SpectrogramResults<float> &spectrogramData);
+template void Renderer::renderSpectrogram(const Parameters &parameters, const SpectrogramResults<double> &spectrogramData);
+template void Renderer::renderSpectrogramFromMagSquared(const Parameters &parameters, const SpectrogramResults<float> &magSquaredData, const std::vector<double> &peaks);
+template void Renderer::renderSpectrogramFromMagSquared(const Parameters &parameters, const SpectrogramResults<double> &magSquaredData, const std::vector<double> &peaks);
+
+void Renderer::drawSpectrogramDecorations(const Parameters &parameters)
+{
+	windowFunctionLabel = "Window: " + parameters.getWindowFunctionDisplayName();
+	showWindowFunctionLabel = parameters.getShowWindowFunctionLabel();
+
+	if (panes.empty()) {
+		drawSpectrogramGrid();
+		drawBorder();
+		drawSpectrogramTickmarks();
+	} else {
+		// draw the grid, border and tickmarks of each pane (the axes are shared, so only the outer panes have tickmarks)
+		const int x0 = plotOriginX;
+		const int y0 = plotOriginY;
+		const int w0 = plotWidth;
+		const int h0 = plotHeight;
+		for (const Pane& pane : panes) {
+			plotOriginX = pane.x;
+			plotOriginY = pane.y;
+			plotWidth = pane.width;
+			plotHeight = pane.height;
+			drawSpectrogramGrid();
+			drawBorder();
+			drawSpectrogramTickmarks(pane.freqAxis, pane.timeAxis);
+			drawPaneLabel(pane.channel);
+		}
+		plotOriginX = x0;
+		plotOriginY = y0;
+		plotWidth = w0;
+		plotHeight = h0;
+	}
 
-	drawSpectrogramGrid();
-	drawBorder();
-	drawSpectrogramTickmarks();
 	drawSpectrogramText();
 	drawSpectrogramHeatMap(parameters.getLinearMag());
 }
@@ -300,7 +440,7 @@ void Renderer::drawSpectrogramGrid()
 	const double xStep = fWidth / numTimeDivs;
 	double x = plotOriginX;
 
-	while (x < fWidth) {
+	while (x < plotOriginX + fWidth) {
 		cairo_move_to(cr, x, plotOriginY);
 		cairo_line_to(cr, x, plotOriginY + plotHeight - 1);
 		x += xStep;
@@ -328,9 +468,10 @@ void Renderer::drawSpectrumGrid()
 	}
 	cairo_stroke (cr);
 
+	// (the frequency axis spans minFreq to nyquist, with gridlines at multiples of freqStep)
 	const double fWidth = static_cast<double>(plotWidth);
-	const double xStep = fWidth * freqStep / nyquist;
-	double x = plotOriginX;
+	const double xStep = fWidth * freqStep / (nyquist - minFreq);
+	double x = plotOriginX + fWidth * (std::ceil(minFreq / freqStep) * freqStep - minFreq) / (nyquist - minFreq);
 	const double xf = plotOriginX + fWidth;
 
 	// draw vertical gridlines
@@ -377,11 +518,12 @@ void Renderer::drawSpectrumTickmarks(bool linearMag)
 	cairo_stroke (cr);
 
 	const double fWidth = static_cast<double>(plotWidth);
-	const double xStep = fWidth * freqStep / nyquist;
+	const double xStep = fWidth * freqStep / (nyquist - minFreq);
 	char fLabelBuf[20];
 	constexpr int ty = s + 15;
-	double f = 0.0;
-	double x = plotOriginX;
+	double f = std::ceil(minFreq / freqStep) * freqStep;
+	double x = plotOriginX + fWidth * (f - minFreq) / (nyquist - minFreq);
+	const int freqDecimals = (freqStep < 1.0) ? static_cast<int>(std::ceil(-std::log10(freqStep))) : 0; // (for narrow frequency ranges)
 	while (x < (fWidth + plotOriginX)) {
 
 		if (freqAxisStyle == FreqAxisFormat_PlusMinusNormalisedFreq) {
@@ -390,7 +532,7 @@ void Renderer::drawSpectrumTickmarks(bool linearMag)
 					(z > 1.0 ? "%0.3f" : "%0.1f"), // more dec. places for higher zooms
 					(2.0 * f / nyquist - 1.0) / z);
 		} else {
-			sprintf(fLabelBuf, "%6.0f", f);
+			sprintf(fLabelBuf, "%6.*f", freqDecimals, f);
 		}
 
 		cairo_text_extents_t freqLabelTextExtents;
@@ -500,6 +642,63 @@ void Renderer::setHorizZoomFactor(double newHorizZoomFactor)
 	horizZoomFactor = newHorizZoomFactor;
 }
 
+PngWriter Renderer::getPngWriter() const
+{
+	return pngWriter;
+}
+
+void Renderer::setPngWriter(const PngWriter &value)
+{
+	pngWriter = value;
+}
+
+int Renderer::getNumThreads() const
+{
+	return numThreads;
+}
+
+void Renderer::setNumThreads(int value)
+{
+	numThreads = std::max(1, value);
+}
+
+std::vector<Renderer::Pane> Renderer::layoutPanes(ChannelLayout layout) const
+{
+	std::vector<int> channels;
+	for (int ch = 0; ch < static_cast<int>(channelsEnabled.size()); ch++) {
+		if (channelsEnabled.at(ch)) {
+			channels.push_back(ch);
+		}
+	}
+
+	const int n = static_cast<int>(channels.size());
+	if (layout == LayoutSingle || n < 2) {
+		return {};
+	}
+
+	// stacked : a single column. tiled : a (roughly square) grid, filled row by row
+	const int cols = (layout == LayoutTiled) ? static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n)))) : 1;
+	const int rows = (n + cols - 1) / cols;
+	const int paneWidth = (plotWidth - (cols - 1) * paneGap) / cols;
+	const int paneHeight = (plotHeight - (rows - 1) * paneGap) / rows;
+
+	std::vector<Pane> result;
+	for (int i = 0; i < n; i++) {
+		const int row = i / cols;
+		const int col = i % cols;
+		Pane pane;
+		pane.channel = channels.at(i);
+		pane.x = plotOriginX + col * (paneWidth + paneGap);
+		pane.y = plotOriginY + row * (paneHeight + paneGap);
+		pane.width = paneWidth;
+		pane.height = paneHeight;
+		pane.freqAxis = (col == cols - 1) || (i == n - 1);
+		pane.timeAxis = (i + cols >= n);
+		result.push_back(pane);
+	}
+	return result;
+}
+
 Renderer::FreqAxisFormat Renderer::getFreqAxisFormat() const
 {
 	return freqAxisStyle;
@@ -538,11 +737,11 @@ std::vector<Marker> Renderer::getTopNFrequencyMarkers(const Parameters& paramete
 	std::vector<Marker> markers; // retval
 
 	const double thresh_Hz = parameters.getTopN_minSpacing().value_or(10.0);
-	size_t thresh = std::ceil(thresh_Hz / (static_cast<double>(nyquist) / numBins));
+	size_t thresh = std::ceil(thresh_Hz / (static_cast<double>(nyquist - minFreq) / numBins));
 	constexpr bool verbose = false;
 
 	if constexpr (verbose) {
-		std::cout << "bins=" << numBins << " Hz/bin= " << nyquist / numBins << " thresh(bins)= " << thresh << std::endl;
+		std::cout << "bins=" << numBins << " Hz/bin= " << (nyquist - minFreq) / numBins << " thresh(bins)= " << thresh << std::endl;
 	}
 
 	size_t i = 0;
@@ -556,7 +755,7 @@ std::vector<Marker> Renderer::getTopNFrequencyMarkers(const Parameters& paramete
 
 		Marker m;
 		m.index = i;
-		m.freq = nyquist * static_cast<double>(freqIndex) /  (numBins - 1);
+		m.freq = minFreq + (nyquist - minFreq) * static_cast<double>(freqIndex) /  (numBins - 1);
 		m.visible = true;
 		m.color = spectrumChannelColors[std::min(static_cast<int>(spectrumChannelColors.size() - 1), channel)];
 		m.mag = mag;
@@ -567,7 +766,7 @@ std::vector<Marker> Renderer::getTopNFrequencyMarkers(const Parameters& paramete
 		if (auto it = used_indexes.lower_bound(freqIndex - thresh); it != used_indexes.end() && *it <= freqIndex + thresh) {
 			if (verbose) {
 				std::cout << "peak frequency " << m.freq << "Hz (mag=" << m.mag << ") is too close to previous peak at "
-						  << nyquist * static_cast<double>(*it) / numBins << std::endl;
+						  << minFreq + (nyquist - minFreq) * static_cast<double>(*it) / numBins << std::endl;
 			}
 			continue; // too close to another peak
 		}
@@ -666,7 +865,7 @@ void Renderer::drawBorder()
 	cairo_stroke(cr);
 }
 
-void Renderer::drawSpectrogramTickmarks()
+void Renderer::drawSpectrogramTickmarks(bool freqAxis, bool timeAxis)
 {
 	cairo_set_line_width (cr, 2);
 	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
@@ -683,7 +882,7 @@ void Renderer::drawSpectrogramTickmarks()
 
 	char fLabelBuf[20];
 
-	while (y > plotOriginY) {
+	while (freqAxis && y > plotOriginY) {
 		sprintf(fLabelBuf, "%d", static_cast<int>(f));
 		cairo_move_to(cr, plotOriginX + plotWidth, y);
 		cairo_line_to(cr, plotOriginX + s + plotWidth - 1, y);
@@ -703,7 +902,7 @@ void Renderer::drawSpectrogramTickmarks()
 	const int tx = -5;
 	constexpr int ty = s + 15;
 
-	while (x < fWidth) {
+	while (timeAxis && x < plotOriginX + fWidth) {
 		sprintf(tLabelBuf, "%6.3f", t);
 		cairo_move_to(cr, x, plotOriginY + plotHeight);
 		cairo_line_to(cr, x, plotOriginY + plotHeight + s -1);
@@ -748,8 +947,10 @@ void Renderer::drawSpectrogramText()
 	cairo_move_to(cr, plotOriginX + (plotWidth - horizAxisLabelExtents.x_advance) / 2.0, height - horizAxisLabelExtents.height);
 	cairo_show_text(cr, horizAxisLabel.c_str());
 
-	// channel mode
-	if (channelMode == "Normal") {
+	// channel mode (panes are labelled individually)
+	if (!panes.empty()) {
+		// (no label)
+	} else if (channelMode == "Normal") {
 		int xpos = plotOriginX + plotWidth;
 		for (int ch = channelsEnabled.size() - 1; ch >=  0; ch--) {
 			if (channelsEnabled.at(ch)) {
@@ -786,17 +987,26 @@ void Renderer::drawSpectrogramText()
 	cairo_restore(cr);
 }
 
+void Renderer::drawPaneLabel(int channel)
+{
+	const std::string s = (channelsEnabled.size() == 2) ? ((channel == 1) ? "R" : "L") : std::to_string(channel);
+	cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+	cairo_set_font_size(cr, fontSizeNormal);
+	cairo_text_extents_t extents;
+	cairo_text_extents(cr, s.c_str(), &extents);
+	cairo_move_to(cr, plotOriginX + 6, plotOriginY + 6 + extents.height);
+	cairo_show_text(cr, s.c_str());
+}
+
 void Renderer::drawSpectrogramHeatMap(bool linearMag)
 {
 	double sc = static_cast<double>(heatMapPalette.size()) / plotHeight;
 
-	// draw the heatmap colours
+	// draw the heatmap colours (as palette indices)
+	IndexedArea& area = addIndexedArea(hmOriginX, plotOriginY, hmWidth, plotHeight);
 	for (int y = 0; y < plotHeight; y++) {
-		int lineAddr = hmOriginX + (plotOriginY + y) * stride32;
-		int32_t color = heatMapPalette.at(static_cast<int>(sc * y));
-		for (int x = 0; x < hmWidth; x++) {
-			pixelBuffer[x + lineAddr] = color;
-		}
+		const uint8_t index = static_cast<uint8_t>(std::min(static_cast<int>(sc * y), static_cast<int>(heatMapPalette.size()) - 1));
+		std::fill(area.indices.begin() + static_cast<ptrdiff_t>(y) * hmWidth, area.indices.begin() + static_cast<ptrdiff_t>(y + 1) * hmWidth, index);
 	}
 
 	// draw the heatmap border
@@ -842,12 +1052,28 @@ void Renderer::drawSpectrogramHeatMap(bool linearMag)
 
 void Renderer::makeNegativeImage()
 {
-	auto endIt = pixelBuffer.end();
-	auto it = pixelBuffer.begin();
-	while (it != endIt)
-	{
-		*it = 0x00ffffff - *it;
-		++it;
+	// the indexed areas are inverted when they are resolved (by inverting the palette), so only the rest of the image is inverted here
+	negative = !negative;
+	for (int y = 0; y < height; y++) {
+		uint32_t* line = pixelBuffer.data() + static_cast<size_t>(y) * stride32;
+		int x = 0;
+		while (x < width) {
+			// find the next indexed area on this line
+			const IndexedArea* next = nullptr;
+			for (const IndexedArea& area : indexedAreas) {
+				if (y >= area.y && y < area.y + area.height && area.x >= x && (next == nullptr || area.x < next->x)) {
+					next = &area;
+				}
+			}
+
+			const int end = (next == nullptr) ? width : next->x;
+			for (; x < end; x++) {
+				line[x] = 0x00ffffff - line[x];
+			}
+			if (next != nullptr) {
+				x = next->x + next->width;
+			}
+		}
 	}
 }
 
@@ -855,6 +1081,52 @@ void Renderer::clear()
 {
 	cairo_set_source_rgb (cr, 0, 0, 0);
 	cairo_paint(cr);
+	indexedAreas.clear();
+	negative = false;
+	panes.clear();
+}
+
+Renderer::IndexedArea& Renderer::addIndexedArea(int x, int y, int w, int h)
+{
+	indexedAreas.push_back({x, y, w, h, std::vector<uint8_t>(static_cast<size_t>(w) * h, 0)});
+	return indexedAreas.back();
+}
+
+void Renderer::resolveIndexedAreas()
+{
+	// the palette, as it appears in the image
+	std::vector<uint32_t> colors(heatMapPalette.size());
+	for (size_t i = 0; i < colors.size(); i++) {
+		const uint32_t color = static_cast<uint32_t>(heatMapPalette[i]) & 0x00ffffff;
+		colors[i] = negative ? 0x00ffffff - color : color;
+	}
+
+	for (const IndexedArea& area : indexedAreas) {
+		for (int y = 0; y < area.height; y++) {
+			const uint8_t* in = area.indices.data() + static_cast<size_t>(y) * area.width;
+			uint32_t* out = pixelBuffer.data() + area.x + static_cast<size_t>(area.y + y) * stride32;
+			for (int x = 0; x < area.width; x++) {
+				const uint32_t overlay = out[x] & 0x00ffffff;
+				if (overlay == 0) {
+					out[x] = colors[in[x]];
+					continue;
+				}
+
+				// blend the color under the (white) overlay, the same way that cairo would have blended the overlay over the color
+				const uint32_t color = static_cast<uint32_t>(heatMapPalette[in[x]]);
+				uint32_t blended = 0;
+				for (int shift = 0; shift < 24; shift += 8) {
+					const uint32_t o = (overlay >> shift) & 0xff;
+					const uint32_t t = ((color >> shift) & 0xff) * (255 - o) + 128;
+					blended |= (o + ((t + (t >> 8)) >> 8)) << shift;
+				}
+				out[x] = negative ? 0x00ffffff - blended : blended;
+			}
+		}
+	}
+
+	indexedAreas.clear();
+	negative = false;
 }
 
 int Renderer::getPlotWidth() const
@@ -877,6 +1149,16 @@ void Renderer::setNyquist(double value)
 	nyquist = value;
 }
 
+double Renderer::getMinFreq() const
+{
+	return minFreq;
+}
+
+void Renderer::setMinFreq(double value)
+{
+	minFreq = value;
+}
+
 double Renderer::getFreqStep() const
 {
 	return freqStep;
@@ -974,6 +1256,14 @@ void Renderer::setVertAxisLabel(const std::string &value)
 
 bool Renderer::writeToFile(const std::string& filename)
 {
+	resolveIndexedAreas();
+
+	// (cairo's own PNG writer is only used when sndspec is built without zlib)
+	if (PngWriter::isAvailable()) {
+		cairo_surface_flush(surface);
+		return pngWriter.write(filename, pixelBuffer.data(), width, height, stride32);
+	}
+
 	return (cairo_surface_write_to_png(surface, filename.c_str()) == CAIRO_STATUS_SUCCESS);
 }
 
@@ -984,7 +1274,8 @@ std::vector<int32_t> Renderer::getHeatMapPalette() const
 
 void Renderer::setHeatMapPalette(const std::vector<int32_t> &value)
 {
-	heatMapPalette = value;
+	// (palette indices are 8 bits)
+	heatMapPalette.assign(value.begin(), value.begin() + std::min(value.size(), size_t{256}));
 }
 
 void Renderer::setMargins()
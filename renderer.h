@@ -11,6 +11,7 @@
 #define RENDERER_H
 
 #include "parameters.h"
+#include "pngwriter.h"
 #include "spectrogram.h"
 
 #include <cairo.h>
@@ -58,7 +59,14 @@ public:
 	~Renderer();
 
 	// spectrogram
-	void renderSpectrogram(const Parameters& parameters, const SpectrogramResults<double>& spectrogramData);
+	// (FloatType : float or double)
+	template <typename FloatType>
+	void renderSpectrogram(const Parameters& parameters, const SpectrogramResults<FloatType>& spectrogramData);
+
+	// renderSpectrogramFromMagSquared() : render directly from (unscaled) magnitude-squared data, given the peak value of each channel.
+	// Each value is mapped straight to a palette index using a table of thresholds, so no conversion to dB is required
+	template <typename FloatType>
+	void renderSpectrogramFromMagSquared(const Parameters& parameters, const SpectrogramResults<FloatType>& magSquaredData, const std::vector<double>& peaks);
 
 	// renderSpectrum() : returns <final plotted values, vertical scaling factor used>
 	std::pair<std::vector<std::vector<double>>, double> renderSpectrum(const Parameters& parameters, const std::vector<std::vector<double>>& spectrumData);
@@ -70,6 +78,8 @@ public:
 	void drawMarkers(const std::vector<Marker>& markers);
 
 	void makeNegativeImage();
+
+	// writeToFile() : resolve the indexed areas (see IndexedArea), and write the image to a PNG file
 	bool writeToFile(const std::string &filename);
 	void clear();
 
@@ -84,6 +94,7 @@ public:
 	void setHeatMapPalette(const std::vector<int32_t> &value);
 	void setNyquist(double value); // required for frequency axis
 	void setFreqStep(double value); // required for frequency axis
+	void setMinFreq(double value); // lowest frequency of spectrum frequency axis (default 0; nyquist is the highest)
 	void setNumTimeDivs(int value); // required for time axis
 	void setStartTime(double value); // required for time axis
 	void setFinishTime(double value); // required for time axis
@@ -95,6 +106,8 @@ public:
 	void setChannelsEnabled(const std::vector<bool> &value);
 	void setFreqAxisFormat(FreqAxisFormat newFreqAxisFormat);
 	void setHorizZoomFactor(double newHorizZoomFactor);
+	void setPngWriter(const PngWriter &value); // (used by writeToFile(), if available)
+	void setNumThreads(int value); // number of threads for plotting panes
 
 	// getters
 	std::vector<int32_t> getHeatMapPalette() const;
@@ -102,6 +115,7 @@ public:
 	int getPlotHeight() const;
 	double getNyquist() const;
 	double getFreqStep() const;
+	double getMinFreq() const;
 	int getNumTimeDivs() const;
 	double getStartTime() const;
 	double getFinishTime() const;
@@ -114,14 +128,67 @@ public:
 	std::vector<bool> getChannelsEnabled() const;
 	FreqAxisFormat getFreqAxisFormat() const;
 	double getHorizZoomFactor() const;
+	PngWriter getPngWriter() const;
+	int getNumThreads() const;
 
 private:
+	// IndexedArea : a rectangle of the image (the spectrogram plot, or the heatmap) which holds palette indices, rather than colors.
+	// The indices are only converted to colors (through the current palette) when the image is resolved, so that changing the palette,
+	// or inverting the image, costs nothing until then. The area is left black in pixelBuffer, and whatever cairo draws over it (in white)
+	// is blended with the colors when they are resolved.
+	struct IndexedArea
+	{
+		int x{0};
+		int y{0};
+		int width{0};
+		int height{0};
+		std::vector<uint8_t> indices; // row-major, from the top row down
+	};
+
+	std::vector<IndexedArea> indexedAreas;
+	bool negative{false}; // (inversion still to be applied to the indexed areas)
+
+	IndexedArea& addIndexedArea(int x, int y, int w, int h);
+
+	// Pane : the part of the plot area in which one channel is plotted (when there is more than one pane)
+	struct Pane
+	{
+		int channel{0};
+		int x{0};
+		int y{0};
+		int width{0};
+		int height{0};
+		bool freqAxis{false}; // (pane is in the rightmost column)
+		bool timeAxis{false}; // (pane is at the bottom of its column)
+	};
+
+	std::vector<Pane> panes; // (empty : the first enabled channel is plotted in the whole plot area)
+	const int paneGap{8};
+	int numThreads{1};
+
+	// layoutPanes() : divide the plot area into panes for the enabled channels. Returns an empty vector if only one channel is to be plotted
+	std::vector<Pane> layoutPanes(ChannelLayout layout) const;
+
+	// resolveIndexedAreas() : convert the indexed areas to colors in pixelBuffer
+	void resolveIndexedAreas();
+
 	void drawBorder();
 
 	void drawSpectrogramGrid();
-	void drawSpectrogramTickmarks();
+	void drawSpectrogramTickmarks(bool freqAxis = true, bool timeAxis = true);
+	void drawPaneLabel(int channel);
 	void drawSpectrogramText();
 	void drawSpectrogramHeatMap(bool linearMag = false);
+	void drawSpectrogramDecorations(const Parameters& parameters);
+
+	// plotSpectrogram() : write the palette indices of the first enabled channel (to an indexed area). makeIndexFunc(channel) returns a function which maps values to palette indices
+	template <typename FloatType, typename MakeIndexFunc>
+	void plotSpectrogram(const SpectrogramResults<FloatType>& spectrogramData, MakeIndexFunc makeIndexFunc);
+
+	// plotPane() : write the palette indices of one channel to an indexed area of any size.
+	// Each pixel takes the lowest index (ie the loudest value) of all the bins and columns which fall into it
+	template <typename FloatType, typename GetIndexFunc>
+	static void plotPane(const SpectrogramResults<FloatType>& spectrogramData, int channel, GetIndexFunc getIndex, int maxIndex, IndexedArea& area);
 
 	void drawSpectrumGrid();
 	void drawSpectrumTickmarks(bool linearMag = false);
@@ -141,6 +208,7 @@ private:
 	// properties required for labelling the chart
 	double nyquist;
 	double freqStep;
+	double minFreq{0.0};
 	int numTimeDivs{5};
 	double startTime{0.0};
 	double finishTime{0.0};
@@ -189,6 +257,7 @@ private:
 	int stride32;
 	cairo_surface_t* surface;
 	cairo_t* cr;
+	PngWriter pngWriter;
 	std::vector<int32_t> heatMapPalette {
 		0x00ffffff,
 		0x00f0fed8,
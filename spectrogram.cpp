@@ -8,169 +8,481 @@
 */
 
 #include "spectrogram.h"
+#include "analysiscache.h"
+#include "analyzer.h"
 #include "window.h"
 #include "reader.h"
 #include "spectrum.h"
 #include "renderer.h"
 #include "raiitimer.h"
+#include "batch.h"
+#include "decibels.h"
+#include "readahead.h"
 
-#include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+// Worker : the set of resources owned by each batch worker, which are re-used from one file to the next
+template <typename FloatType>
+struct Sndspec::Spectrogram::Worker
+{
+	Worker(int width, int height, int numThreads) : renderer(width, height), analyzers(numThreads)
+	{
+		static const int reservedChannels(2); // stereo (most common use case)
+		for (auto& threadAnalyzers : analyzers) {
+			threadAnalyzers.reserve(reservedChannels);
+		}
+	}
+
+	// getMaxPlotWidth(), getMaxPlotHeight() : the analysis is made for the largest plot of all of the renderers (smaller plots are pooled down from it)
+	int getMaxPlotWidth() const
+	{
+		int w = renderer.getPlotWidth();
+		for (const auto& rendition : renditions) {
+			w = std::max(w, rendition->getPlotWidth());
+		}
+		return w;
+	}
+
+	int getMaxPlotHeight() const
+	{
+		int h = renderer.getPlotHeight();
+		for (const auto& rendition : renditions) {
+			h = std::max(h, rendition->getPlotHeight());
+		}
+		return h;
+	}
+
+	Renderer renderer;
+	std::vector<std::unique_ptr<Renderer>> renditions; // one for each --rendition, in order
+	SpectrogramResults<FloatType> spectrogramData;
+	std::vector<std::vector<std::unique_ptr<Analyzer<FloatType>>>> analyzers; // a set of analyzers (one per channel) for each analysis thread
+};
 
 void Sndspec::Spectrogram::makeSpectrogramFromFile(const Sndspec::Parameters &parameters)
 {
-	if (parameters.getInputFiles().empty()) {
+	const std::vector<std::string> inputFiles = parameters.getInputFiles();
+	if (inputFiles.empty()) {
 		std::cout << "No input files specified. Nothing to do." << std::endl;
+		return;
 	}
 
-	static const int reservedChannels(2); // stereo (most common use case)
+	if (parameters.getPrecision() == PrecisionSingle) {
+		makeSpectrograms<float>(parameters, inputFiles);
+	} else {
+		makeSpectrograms<double>(parameters, inputFiles);
+	}
+}
 
-	// prepare a renderer
-	Renderer renderer(parameters.getImgWidth(), parameters.getImgHeight());
+template <typename FloatType>
+void Sndspec::Spectrogram::makeSpectrograms(const Sndspec::Parameters &parameters, const std::vector<std::string> &inputFiles)
+{
+	// prepare a set of resources for each worker
+	const int numWorkers = getNumBatchWorkers(inputFiles.size(), parameters.getJobs());
+	const int numThreads = getNumThreads(parameters.getThreads(), numWorkers);
+	PngWriter pngWriter;
+	pngWriter.setCompressionLevel(parameters.getPngLevel());
+	pngWriter.setIndexed(parameters.getPngPalette());
+	pngWriter.setNumThreads(numThreads);
+
+	std::vector<std::unique_ptr<Worker<FloatType>>> workers;
+	for (int w = 0; w < numWorkers; w++) {
+		workers.emplace_back(new Worker<FloatType>(parameters.getImgWidth(), parameters.getImgHeight(), numThreads));
+		workers.back()->renderer.setPngWriter(pngWriter);
+		workers.back()->renderer.setNumThreads(numThreads);
+		for (const RenditionSpec& rendition : parameters.getRenditions()) {
+			workers.back()->renditions.emplace_back(new Renderer(rendition.width, rendition.height));
+			workers.back()->renditions.back()->setPngWriter(pngWriter);
+			workers.back()->renditions.back()->setNumThreads(numThreads);
+		}
+	}
 
-	auto fftSize = Spectrum::selectBestFFTSizeFromSpectrumSize(renderer.getPlotHeight());
-	auto spectrumSize = Spectrum::convertFFTSizeToSpectrumSize(fftSize);
-	const int plotWidth = renderer.getPlotWidth();
+	// all workers have the same set of renderers, so the FFT size and window can be shared
+	const int fftSize = Spectrum::selectBestFFTSizeFromSpectrumSize(workers.at(0)->getMaxPlotHeight());
 
 	// make a suitable FFT Window
-	Sndspec::Window<double> window;
 	const double param
 			= parameters.getWindowFunctionParameters().empty() ?
 				   Sndspec::Window<double>::kaiserBetaFromDecibels(parameters.getDynRange())
 				 : parameters.getWindowFunctionParameters().at(0);
-	window.generate(parameters.getWindowFunction(), fftSize, param);
-
-	// prepare storage for spectrogram results
-	SpectrogramResults<double> spectrogramData;
-	spectrogramData.reserve(reservedChannels);
-
-	// prepare the spectrum analyzers
-	std::vector<std::unique_ptr<Spectrum>> analyzers;
-	analyzers.reserve(reservedChannels);
+	const auto window = Sndspec::Window<double>::getCached(parameters.getWindowFunction(), fftSize, param);
 
-	for (const std::string& inputFilename : parameters.getInputFiles()) {
-		std::cout << "Opening input file: " << inputFilename << " ... ";
-		Sndspec::Reader<double> r(inputFilename, fftSize, plotWidth);
+	// (window is always generated in double-precision)
+	const std::vector<FloatType> windowData(window->begin(), window->end());
 
-		if (r.getSndFileHandle() == nullptr || r.getSndFileHandle()->error() != SF_ERR_NO_ERROR) {
-			std::cout << "couldn't open file !" << std::endl;
-		} else {
+	runBatch(inputFiles.size(), numWorkers, [&](size_t i, int w, std::ostream& log) {
+		makeSpectrogram(parameters, inputFiles.at(i), windowData, *workers.at(w), log);
+	});
+}
 
-			SndSpec::RaiiTimer _t;
-			std::cout << "ok" << std::endl;
-			int nChannels = r.getNChannels();
-			std::cout << "channels: " << nChannels << std::endl;
+template <typename FloatType>
+void Sndspec::Spectrogram::makeSpectrogram(const Sndspec::Parameters &parameters, const std::string &inputFilename, const std::vector<FloatType>& window,
+										   Worker<FloatType>& worker, std::ostream& log)
+{
+	// number of spectrogram columns handed to an analysis thread at a time (a whole number of FFT batches)
+	const int batchSize = parameters.getFFTBatch();
+	const int64_t columnChunkSize = (7 + batchSize) / batchSize * batchSize; // (at least 8)
+
+	const int fftSize = static_cast<int>(window.size());
+	const int spectrumSize = Spectrum::convertFFTSizeToSpectrumSize(fftSize);
+	Renderer& renderer = worker.renderer;
+	SpectrogramResults<FloatType>& spectrogramData = worker.spectrogramData;
+	const int plotWidth = worker.getMaxPlotWidth();
+
+	log << "Opening input file: " << inputFilename << " ... ";
+	Sndspec::Reader<FloatType> r(inputFilename, fftSize, plotWidth);
+
+	if (r.getSndFileHandle() == nullptr || r.getSndFileHandle()->error() != SF_ERR_NO_ERROR) {
+		log << "couldn't open file !" << std::endl;
+	} else {
+
+		SndSpec::RaiiTimer _t(log);
+		log << "ok" << std::endl;
+		int nChannels = r.getNChannels();
+		log << "channels: " << nChannels << std::endl;
+
+		// resize output storage (according to number of channels).
+		// The results are stored transposed (bin-major), which matches the order in which the renderer writes pixels
+		spectrogramData.resize(nChannels, plotWidth, spectrumSize, SpectrogramResults<FloatType>::BinMajor);
+
+		// set specific time range
+		auto setTimeRange = [&parameters](Reader<FloatType>& reader) {
+			if (parameters.hasTimeRange()) {
+				reader.setStartPos(std::max(INT64_C(0), std::min(static_cast<int64_t>(reader.getSamplerate() * parameters.getStart()), reader.getNFrames())));
+				reader.setFinishPos(std::max(INT64_C(0), std::min(static_cast<int64_t>(reader.getSamplerate() * parameters.getFinish()), reader.getNFrames())));
+			}
+		};
+		setTimeRange(r);
+
+		// Each column may be made up of a number of evenly-spaced sub-blocks, which the reader reads as separate blocks, and which are then reduced to a single spectrum:
+		// with --column-aggregate, as many blocks as it takes to cover the whole of the column's time span; with --column-average, the given number of blocks (averaged).
+		// (fast preview reads exactly one block per column)
+		const ColumnAggregation aggregation = parameters.getFastPreview() ? AggregateNone
+											: (parameters.getColumnAggregation() == AggregateNone && parameters.getColumnAverage() > 1) ? AggregateMean
+											: parameters.getColumnAggregation();
+		const int subBlocks = (aggregation == AggregateNone) ? 1
+							: (parameters.getColumnAggregation() == AggregateNone) ? parameters.getColumnAverage()
+							: static_cast<int>(std::max(INT64_C(1), std::min((r.getInterval() + fftSize - 1) / fftSize, static_cast<int64_t>(std::numeric_limits<int>::max() / plotWidth))));
+		const int numBlocks = plotWidth * subBlocks;
+		if (subBlocks > 1) {
+			log << "blocks per column: " << subBlocks << std::endl;
+		}
 
-			// provide the reader with the FFT window. The Reader will apply the window to each block it reads.
-			r.setWindow(window.getData());
+		// look for the results in the analysis cache (--cache).
+		// The key identifies the file's contents, and every parameter on which the (magnitude-squared) results depend
+		std::string cacheKey;
+		bool cached = false;
+		if (parameters.getAnalysisCache()) {
+			cacheKey = AnalysisCache::getFileKey(inputFilename);
+			if (!cacheKey.empty()) {
+				std::ostringstream key;
+				key << cacheKey << ";precision=" << sizeof(FloatType) << ";fft=" << fftSize
+					<< ";window=" << AnalysisCache::hash(window.data(), window.size() * sizeof(FloatType))
+					<< ";channel-mode=" << parameters.getChannelMode() << ";range=" << r.getStartPos() << "-" << r.getFinishPos()
+					<< ";columns=" << plotWidth << ";blocks=" << subBlocks << ";aggregation=" << aggregation;
+				if (aggregation == AggregatePercentile) {
+					key << ";percentile=" << parameters.getColumnPercentile();
+				}
+				cacheKey = key.str();
+				cached = AnalysisCache::load(cacheKey, spectrogramData);
+				if (cached) {
+					log << "analysis loaded from cache" << std::endl;
+				}
+			}
+		}
 
-			// resize output storage (according to number of channels)
-			spectrogramData.resize(nChannels, std::vector<std::vector<double>>(plotWidth, std::vector<double>(spectrumSize, 0.0)));
+		// decide whether to stream or seek.
+		// In auto mode, stream whenever at least half of the decoded frames would actually be used
+		// (fast preview always seeks)
+		const bool streaming = !parameters.getFastPreview()
+				&& ((parameters.getReadMode() == ReadStream)
+					|| (parameters.getReadMode() == ReadAuto && r.getInterval() / subBlocks <= 2 * static_cast<int64_t>(fftSize)));
+
+		// Each analysis thread gets its own reader (with a private file handle) and its own set of analyzers,
+		// and writes its results directly into its own columns of spectrogramData.
+		// Readers are created on first use, by the thread which uses them.
+		const int numThreads = static_cast<int>(worker.analyzers.size());
+		std::vector<std::unique_ptr<Reader<FloatType>>> readers(numThreads);
+
+		// Each analyzer transforms a batch of blocks at a time. The reader writes each block into the next free slot of the batch,
+		// and when the batch is full, it is transformed and the results are written to the columns from which the blocks came.
+		// pendingColumns[t][ch] : the column positions of the occupied slots of the batch
+		std::vector<std::vector<std::vector<int>>> pendingColumns(numThreads, std::vector<std::vector<int>>(nChannels));
+
+		// percentileBuffers[t][ch] : the spectra of each sub-block of the current column, stored bin-major (only used for percentiles)
+		std::vector<std::vector<std::vector<FloatType>>> percentileBuffers(numThreads, std::vector<std::vector<FloatType>>(nChannels));
+		const int percentileRank = static_cast<int>(std::lround(parameters.getColumnPercentile() / 100.0 * (subBlocks - 1)));
+
+		auto flushBatch = [&](int t, int ch) {
+			Analyzer<FloatType>* analyzer = worker.analyzers.at(t).at(ch).get();
+			std::vector<int>& columns = pendingColumns[t][ch];
+			if (!columns.empty()) {
+				analyzer->exec(); // (unoccupied slots of a partial batch are transformed too, but their results are ignored)
+				for (size_t slot = 0; slot < columns.size(); slot++) {
+					if (subBlocks == 1) {
+						analyzer->calcMagSquared(static_cast<int>(slot), spectrogramData.column(ch, columns[slot]), spectrogramData.getBinStride()); // magSquared avoids having do to square root !
+						continue;
+					}
+
+					// reduce the sub-block into its column.
+					// (all of the sub-blocks of a column arrive at the same thread, in order)
+					const int subBlock = columns[slot] % subBlocks;
+					FloatType* column = spectrogramData.column(ch, columns[slot] / subBlocks);
+					if (aggregation == AggregateMax) {
+						analyzer->maxMagSquared(static_cast<int>(slot), column, spectrogramData.getBinStride());
+					} else if (aggregation == AggregatePercentile) {
+						// gather the sub-blocks, and find the percentile of each bin once the last sub-block of the column has arrived
+						std::vector<FloatType>& buffer = percentileBuffers[t][ch];
+						buffer.resize(static_cast<size_t>(subBlocks) * spectrumSize);
+						analyzer->calcMagSquared(static_cast<int>(slot), buffer.data() + subBlock, subBlocks);
+						if (subBlock == subBlocks - 1) {
+							for (int b = 0; b < spectrumSize; b++) {
+								FloatType* values = buffer.data() + static_cast<size_t>(b) * subBlocks;
+								std::nth_element(values, values + percentileRank, values + subBlocks);
+								column[b * spectrogramData.getBinStride()] = values[percentileRank];
+							}
+						}
+					} else {
+						// (the sum is proportional to the mean, and the results are normalized to their peak later)
+						analyzer->accumulateMagSquared(static_cast<int>(slot), column, spectrogramData.getBinStride());
+					}
+				}
+				columns.clear();
+			}
+		};
 
-			// set specific time range
-			if (parameters.hasTimeRange()) {
-				r.setStartPos(std::max(0, std::min(static_cast<int>(r.getSamplerate() * parameters.getStart()), r.getNFrames())));
-				r.setFinishPos(std::max(0, std::min(static_cast<int>(r.getSamplerate() * parameters.getFinish()), r.getNFrames())));
+		// create a spectrum analyzer for each channel if not already existing
+		auto prepareAnalyzers = [&](int t) -> std::vector<std::unique_ptr<Analyzer<FloatType>>>& {
+			std::vector<std::unique_ptr<Analyzer<FloatType>>>& analyzers = worker.analyzers.at(t);
+			while (static_cast<int>(analyzers.size()) < nChannels) {
+				analyzers.emplace_back(new Analyzer<FloatType>(fftSize, batchSize));
 			}
+			return analyzers;
+		};
 
-			for (int ch = 0; ch < nChannels; ch ++) {
+		auto makeReader = [&]() -> Reader<FloatType>* {
+			Reader<FloatType>* reader = new Reader<FloatType>(inputFilename, fftSize, numBlocks);
 
-				// create a spectrum analyzer for each channel if not already existing
-				if (ch + 1 > analyzers.size()) {
-					analyzers.emplace_back(new Spectrum(fftSize));
+			// provide the reader with the FFT window. The Reader will apply the window to each block it reads.
+			reader->setWindow(window);
+			setTimeRange(*reader);
+			reader->setStreaming(streaming);
+			return reader;
+		};
+
+		auto getReader = [&](int t) -> Reader<FloatType>* {
+			std::unique_ptr<Reader<FloatType>>& reader = readers.at(t);
+			if (reader == nullptr) {
+				reader.reset(makeReader());
+
+				std::vector<std::unique_ptr<Analyzer<FloatType>>>& analyzers = prepareAnalyzers(t);
+				for (int ch = 0; ch < nChannels; ch ++) {
+					// give the reader direct write-access to the analyzer input buffer
+					reader->setChannelBuffer(ch, analyzers.at(ch)->getTdBuf());
 				}
 
-				// give the reader direct write-access to the analyzer input buffer
-				r.setChannelBuffer(ch, analyzers.at(ch)->getTdBuf());
+				// set a callback function to queue each block read for spectrum analysis
+				reader->setProcessingFunc([&analyzers, &pendingColumns, &flushBatch, t, r = reader.get()](int pos, int channel, const FloatType* data) -> void {
+					Analyzer<FloatType>* analyzer = analyzers.at(channel).get();
+					std::vector<int>& columns = pendingColumns[t][channel];
+					assert(data == analyzer->getTdBuf(static_cast<int>(columns.size())));
+					(void)data;
+					columns.push_back(pos);
+					if (static_cast<int>(columns.size()) == analyzer->getBatchSize()) {
+						flushBatch(t, channel);
+					}
+					r->setChannelBuffer(channel, analyzer->getTdBuf(static_cast<int>(columns.size()))); // next block goes into next slot
+				});
+			}
+			return reader.get();
+		};
+
+		const DeinterleaveMode deinterleaveMode = (parameters.getChannelMode() == Sum) ? DeinterleaveSum
+												: (parameters.getChannelMode() == Difference) ? DeinterleaveDifference
+												: DeinterleaveNormal;
+
+		if (!cached) {
+			if (subBlocks > 1) {
+				// sub-blocks are reduced into their columns
+				for (int ch = 0; ch < nChannels; ch++) {
+					std::fill(spectrogramData.channel(ch), spectrogramData.channel(ch) + spectrogramData.getChannelSize(), FloatType{0});
+				}
+				if (parameters.getReadAhead() > 0) {
+					log << "(read-ahead is not used when columns are made up of several blocks)" << std::endl;
+				}
 			}
-
-			// set a callback function to execute spectrum analysis for each block read
-			r.setProcessingFunc([&analyzers, &spectrogramData](int pos, int channel, const double* data) -> void {
-				Spectrum* analyzer = analyzers.at(channel).get();
-				assert(data == analyzer->getTdBuf());
-				analyzer->exec();
-				analyzer->calcMagSquared(spectrogramData[channel][pos]); // magSquared avoids having do to square root !
-			});
 
 			// read (and analyze) the file
-			if (parameters.getChannelMode() == Sum) {
-				r.readSum();
-			} else if (parameters.getChannelMode() == Difference) {
-				r.readDifference();
+			if (parameters.getReadAhead() > 0 && subBlocks == 1) {
+				// a single decoder thread reads all of the columns (in order), and the analysis threads take them from a queue
+				std::unique_ptr<Reader<FloatType>> decoderReader(makeReader());
+				ReadAhead<FloatType> readAhead(*decoderReader, parameters.getReadAhead());
+				readAhead.start(0, plotWidth, deinterleaveMode);
+
+				auto consume = [&](int t) {
+					std::vector<std::unique_ptr<Analyzer<FloatType>>>& analyzers = prepareAnalyzers(t);
+					while (typename ReadAhead<FloatType>::Block* block = readAhead.pop()) {
+						for (int ch = 0; ch < readAhead.getNumOutputs(); ch++) {
+							std::vector<int>& columns = pendingColumns[t][ch];
+							const FloatType* data = block->channel(ch, fftSize);
+							std::copy(data, data + fftSize, analyzers.at(ch)->getTdBuf(static_cast<int>(columns.size())));
+							columns.push_back(block->x);
+							if (static_cast<int>(columns.size()) == analyzers.at(ch)->getBatchSize()) {
+								flushBatch(t, ch);
+							}
+						}
+						readAhead.release(block);
+					}
+
+					// analyze any partial batches
+					for (int ch = 0; ch < nChannels; ch++) {
+						flushBatch(t, ch);
+					}
+				};
+
+				std::vector<std::thread> consumers;
+				for (int t = 1; t < numThreads; t++) {
+					consumers.emplace_back(consume, t);
+				}
+				consume(0);
+				for (auto& consumer : consumers) {
+					consumer.join();
+				}
+
+				log << "read-ahead: average queue length " << readAhead.getAverageQueueLength() << " of " << readAhead.getDepth()
+					<< ", decoder waited " << readAhead.getDecoderStallTime() << "s, analysis waited " << readAhead.getConsumerStallTime() << "s" << std::endl;
 			} else {
-				r.readDeinterleaved();
+				// (all of the sub-blocks of a column are handled by the same thread, since each chunk is a whole number of columns)
+				runWorkStealing(numBlocks, numThreads, columnChunkSize * subBlocks, [&](int t, int64_t xBegin, int64_t xEnd) {
+					Reader<FloatType>* reader = getReader(t);
+					if (deinterleaveMode == DeinterleaveSum) {
+						reader->readSum(xBegin, xEnd);
+					} else if (deinterleaveMode == DeinterleaveDifference) {
+						reader->readDifference(xBegin, xEnd);
+					} else {
+						reader->readDeinterleaved(xBegin, xEnd);
+					}
+
+					// analyze any partial batches, and direct the reader back to the first slot
+					for (int ch = 0; ch < nChannels; ch++) {
+						flushBatch(t, ch);
+						reader->setChannelBuffer(ch, worker.analyzers.at(t).at(ch)->getTdBuf(0));
+					}
+				});
 			}
 
-			if (parameters.getLinearMag()) {
-				// scale the magnitude as percentage
-				renderer.setChannelsEnabled(convertToLinear(spectrogramData, /* fromMagSquared = */ true));
-			} else {
-				// scale the data into dB
-				renderer.setChannelsEnabled(convertToDb(spectrogramData, /* fromMagSquared = */ true));
+			if (!cacheKey.empty() && AnalysisCache::save(cacheKey, spectrogramData, static_cast<int64_t>(parameters.getCacheSize()) * 1024 * 1024)) {
+				log << "analysis saved to cache" << std::endl;
 			}
+		}
 
-			// set render parameters
-			const double startTime = static_cast<double>(r.getStartPos()) / r.getSamplerate();
-			const double finishTime = static_cast<double>(r.getFinishPos()) / r.getSamplerate();
-			renderer.setNyquist(r.getSamplerate() / 2);
-			renderer.setFreqStep(parameters.getFrequencyStep());
-			renderer.setNumTimeDivs(5);
-			renderer.setInputFilename(inputFilename);
-			renderer.setStartTime(startTime);
-			renderer.setFinishTime(finishTime);
-			renderer.setDynRange(parameters.getDynRange());
-
-			std::cout << "Rendering ... ";
-			// main plot area
-			renderer.renderSpectrogram(parameters, spectrogramData);
+		std::vector<double> peaks; // (only used for dB)
+		std::vector<bool> channelsEnabled;
+		if (parameters.getLinearMag()) {
+			// scale the magnitude as percentage
+			channelsEnabled = convertToLinear(spectrogramData, /* fromMagSquared = */ true);
+		} else {
+			// leave the data as magnitude-squared : the renderer maps it straight to palette colors, using the peak of each channel
+			peaks = findPeaks(spectrogramData);
+			channelsEnabled.resize(peaks.size());
+			std::transform(peaks.begin(), peaks.end(), channelsEnabled.begin(), [](double peak) -> bool {
+				return std::fpclassify(peak) != FP_ZERO;
+			});
+		}
 
-			if (parameters.hasWhiteBackground()) {
-				renderer.makeNegativeImage();
-			}
+		// determine output filename
+		std::string outputFilename;
+		if (parameters.getOutputPath().empty()) {
+			outputFilename = replaceFileExt(inputFilename, "png");
+		} else {
+			outputFilename = enforceTrailingSeparator(parameters.getOutputPath()) + getFilenameOnly(replaceFileExt(inputFilename, "png"));
+		}
 
-			std::cout << "Done\n";
+		const double startTime = static_cast<double>(r.getStartPos()) / r.getSamplerate();
+		const double finishTime = static_cast<double>(r.getFinishPos()) / r.getSamplerate();
 
-			// determine output filename
-			std::string outputFilename;
-			if (parameters.getOutputPath().empty()) {
-				outputFilename = replaceFileExt(inputFilename, "png");
+		// render() : render the results with the given parameters, and save the image
+		auto render = [&](Renderer& target, const Parameters& renderParameters, const std::string& filename) {
+			// set render parameters
+			target.setChannelsEnabled(channelsEnabled);
+			target.setNyquist(r.getSamplerate() / 2);
+			target.setFreqStep(renderParameters.getFrequencyStep());
+			target.setNumTimeDivs(5);
+			target.setInputFilename(inputFilename);
+			target.setStartTime(startTime);
+			target.setFinishTime(finishTime);
+			target.setDynRange(renderParameters.getDynRange());
+
+			log << "Rendering ... ";
+			// main plot area
+			if (renderParameters.getLinearMag()) {
+				target.renderSpectrogram(renderParameters, spectrogramData);
 			} else {
-				outputFilename = enforceTrailingSeparator(parameters.getOutputPath()) + getFilenameOnly(replaceFileExt(inputFilename, "png"));
+				target.renderSpectrogramFromMagSquared(renderParameters, spectrogramData, peaks);
 			}
 
-			if (!outputFilename.empty()) {
-				std::cout << "Saving to " << outputFilename << std::flush;
-				if (renderer.writeToFile(outputFilename)) {
-					std::cout << " ... OK" << std::endl;
+			if (renderParameters.hasWhiteBackground()) {
+				target.makeNegativeImage();
+			}
+
+			log << "Done\n";
+
+			if (!filename.empty()) {
+				log << "Saving to " << filename << std::flush;
+				if (target.writeToFile(filename)) {
+					log << " ... OK" << std::endl;
 				} else {
-					std::cout << " ... ERROR" << std::endl;
+					log << " ... ERROR" << std::endl;
 				}
 			} else {
-				std::cout << "Error: couldn't deduce output filename" << std::endl;
+				log << "Error: couldn't deduce output filename" << std::endl;
 			}
 
-			renderer.clear();
+			target.clear();
+		};
+
+		render(renderer, parameters, outputFilename);
+
+		// each rendition is saved alongside the main image, with its size (and any other differences) appended to the filename
+		const std::vector<RenditionSpec> renditionSpecs = parameters.getRenditions();
+		for (size_t i = 0; i < renditionSpecs.size() && i < worker.renditions.size(); i++) {
+			const RenditionSpec& spec = renditionSpecs.at(i);
+			Parameters renditionParameters{parameters};
+			std::ostringstream suffix;
+			suffix << "_" << spec.width << "x" << spec.height;
+			if (spec.dynRange.has_value()) {
+				renditionParameters.setDynRange(*spec.dynRange);
+				suffix << "_" << *spec.dynRange << "dB";
+			}
+			if (spec.whiteBackground.has_value()) {
+				renditionParameters.setHasWhiteBackground(*spec.whiteBackground);
+				suffix << (*spec.whiteBackground ? "_white" : "_black");
+			}
 
-		} // ends successful file-open
-	} // ends loop over files
+			const std::string renditionFilename = outputFilename.empty() ? outputFilename
+																		 : outputFilename.substr(0, outputFilename.rfind('.')) + suffix.str() + ".png";
+			render(*worker.renditions.at(i), renditionParameters, renditionFilename);
+		}
+
+	} // ends successful file-open
 }
 
 std::vector<bool> Sndspec::Spectrogram::convertToDb(SpectrogramResults<double> &s, bool fromMagSquared)
 {
-	const int numChannels = s.size();
-	const int numSpectrums = s.at(0).size();
-	const int numBins = s.at(0).at(0).size();
+	const int numChannels = s.getNumChannels();
+	const size_t channelSize = s.getChannelSize();
 	std::vector<bool> hasSignal(numChannels, false);
 
 	for (int c = 0; c < numChannels; c++) {
+		double* data = s.channel(c);
 
 		// find peak
-		double peak{0.0};
-		for (int x = 0; x < numSpectrums; x++) {
-			for (int b = 0; b < numBins; b++) {
-				peak = std::max(peak, s[c][x][b]);
-			}
-		}
+		const double peak = Decibels::findPeak(data, channelSize);
 
 		if (std::fpclassify(peak) != FP_ZERO) {
 
@@ -181,48 +493,46 @@ std::vector<bool> Sndspec::Spectrogram::convertToDb(SpectrogramResults<double> &
 			double floor = std::max(std::numeric_limits<double>::min(), peak * pow(10.0, -300.0 / dBMult)); // 300dB below peak or smallest normal number
 			assert(std::isnormal(floor));
 
-			// function to convert to dB
-			auto scaleFunc = [scale = 1.0 / peak, dBMult, floor] (double v) -> double {
-				return dBMult * std::log10(std::max(scale * v, floor));
-			};
-
-			// scale the data
-			for (int x = 0; x < numSpectrums; x++) {
-				std::transform (s[c][x].begin(), s[c][x].end(), s[c][x].begin(), scaleFunc);
-			}
+			// scale the data and convert to dB
+			Decibels::convert(data, channelSize, 1.0 / peak, floor, dBMult);
 		}
 	}
 
 	return hasSignal;
 }
 
-std::vector<bool> Sndspec::Spectrogram::convertToLinear(SpectrogramResults<double> &s, bool fromMagSquared)
+template <typename FloatType>
+std::vector<double> Sndspec::Spectrogram::findPeaks(const SpectrogramResults<FloatType> &s)
 {
-	const int numChannels = s.size();
-	const int numSpectrums = s.at(0).size();
-	const int numBins = s.at(0).at(0).size();
+	std::vector<double> peaks(s.getNumChannels());
+	for (int c = 0; c < s.getNumChannels(); c++) {
+		peaks[c] = Decibels::findPeak(s.channel(c), s.getChannelSize());
+	}
+	return peaks;
+}
+
+template <typename FloatType>
+std::vector<bool> Sndspec::Spectrogram::convertToLinear(SpectrogramResults<FloatType> &s, bool fromMagSquared)
+{
+	const int numChannels = s.getNumChannels();
+	const size_t channelSize = s.getChannelSize();
 	std::vector<bool> hasSignal(numChannels, false);
 
 	for (int c = 0; c < numChannels; c++) {
+		FloatType* data = s.channel(c);
 
 		// find peak
 		double peak{0.0};
 		if (fromMagSquared) {
-			for (int x = 0; x < numSpectrums; x++) {
-				for (int b = 0; b < numBins; b++) {
-					peak = std::max(peak, std::sqrt (s[c][x][b]));
-				}
+			for (size_t i = 0; i < channelSize; i++) {
+				peak = std::max(peak, std::sqrt(static_cast<double>(data[i])));
 			}
 		} else {
-			for (int x = 0; x < numSpectrums; x++) {
-				for (int b = 0; b < numBins; b++) {
-					peak = std::max(peak, s[c][x][b]);
-				}
+			for (size_t i = 0; i < channelSize; i++) {
+				peak = std::max(peak, static_cast<double>(data[i]));
 			}
 		}
 
-		std::cout << "peak " << peak << std::endl;
-
 		if (std::fpclassify(peak) != FP_ZERO) {
 
 			hasSignal[c] = true;
@@ -231,26 +541,28 @@ std::vector<bool> Sndspec::Spectrogram::convertToLinear(SpectrogramResults<doubl
 
 			// function to convert to percentage of fullScale
 			if (fromMagSquared) {
-				auto scaleFunc = [scale] (double v) -> double {
-					return scale * std::sqrt(v) - 100.0;
+				auto scaleFunc = [scale] (FloatType v) -> FloatType {
+					return static_cast<FloatType>(scale * std::sqrt(v) - 100.0);
 				};
 
 				// scale the data
-				for (int x = 0; x < numSpectrums; x++) {
-					std::transform (s[c][x].begin(), s[c][x].end(), s[c][x].begin(), scaleFunc);
-				}
+				std::transform(data, data + channelSize, data, scaleFunc);
 			} else {
-				auto scaleFunc = [scale] (double v) -> double {
-					return scale * v - 100.0;
+				auto scaleFunc = [scale] (FloatType v) -> FloatType {
+					return static_cast<FloatType>(scale * v - 100.0);
 				};
 
 				// scale the data
-				for (int x = 0; x < numSpectrums; x++) {
-					std::transform (s[c][x].begin(), s[c][x].end(), s[c][x].begin(), scaleFunc);
-				}
+				std::transform(data, data + channelSize, data, scaleFunc);
 			}
 		}
 	}
 
 	return hasSignal;
 }
+
+// explicit instantiations
+template std::vector<double> Sndspec::Spectrogram::findPeaks(const SpectrogramResults<float>& s);
+template std::vector<double> Sndspec::Spectrogram::findPeaks(const SpectrogramResults<double>& s);
+template std::vector<bool> Sndspec::Spectrogram::convertToLinear(SpectrogramResults<float>& s, bool fromMagSquared);
+template std::vector<bool> Sndspec::Spectrogram::convertToLinear(SpectrogramResults<double>& s, bool fromMagSquared);
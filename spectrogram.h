@@ -11,11 +11,13 @@
 #define SPECTROGRAM_H
 
 #include "parameters.h"
+#include "spectrogramresults.h"
 
-namespace Sndspec {
+#include <ostream>
+#include <string>
+#include <vector>
 
-template <typename T>
-using SpectrogramResults = std::vector<std::vector<std::vector<T>>>; // (channels x spectrums x numbins)
+namespace Sndspec {
 
 class Spectrogram {
 
@@ -25,7 +27,26 @@ public:
 	// these functions do in-place conversion of magnitude spectrum data into a standard decibel or linear range
 	// return value is a vector of bools signifying whether each respective channel has a signal present
 	static std::vector<bool> convertToDb(SpectrogramResults<double>& s, bool fromMagSquared = true); // return value indicates whether each channel has a signal (ie not silent)
-	static std::vector<bool> convertToLinear(SpectrogramResults<double> &s, bool fromMagSquared = false);
+	template <typename FloatType>
+	static std::vector<bool> convertToLinear(SpectrogramResults<FloatType> &s, bool fromMagSquared = false); // (FloatType : float or double)
+
+	// findPeaks() : returns the peak value of each channel
+	template <typename FloatType>
+	static std::vector<double> findPeaks(const SpectrogramResults<FloatType>& s); // (FloatType : float or double)
+
+private:
+	template <typename FloatType>
+	struct Worker; // resources owned by each batch worker
+
+	// makeSpectrograms() : analyze and render all of the input files, using FloatType (float or double) for analysis
+	template <typename FloatType>
+	static void makeSpectrograms(const Parameters& parameters, const std::vector<std::string>& inputFiles);
+
+	// makeSpectrogram() : analyze and render a single file, using the given worker's resources.
+	// All console output is written to log.
+	template <typename FloatType>
+	static void makeSpectrogram(const Parameters& parameters, const std::string& inputFilename, const std::vector<FloatType>& window,
+								Worker<FloatType>& worker, std::ostream& log);
 };
 
 } // namespace Sndspec
@@ -0,0 +1,194 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef SPECTROGRAMRESULTS_H
+#define SPECTROGRAMRESULTS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace Sndspec {
+
+// SpectrogramResults : storage for (channels x spectrums x numbins) spectrogram data.
+// All the data lives in a single, aligned, contiguous buffer (one allocation, which is re-used when resizing to a smaller or equal size).
+// Elements are addressed using strides, so that consumers can work with either layout:
+// ColumnMajor : the bins of each spectrum (column) are contiguous. (This is the natural order of the FFT output)
+// BinMajor : the columns of each bin are contiguous, ie the data is transposed, so that each bin forms a row in the same order as the rendered pixels.
+// The contiguous dimension is padded to a multiple of the alignment, so that every row / column begins on an aligned boundary.
+// Padding elements are always zero.
+
+template <typename T>
+class SpectrogramResults
+{
+public:
+	enum Layout
+	{
+		ColumnMajor,
+		BinMajor
+	};
+
+	static constexpr size_t alignment = 64; // bytes (cache line; also suits AVX-512)
+
+	SpectrogramResults() = default;
+
+	SpectrogramResults(int numChannels, int numColumns, int numBins, Layout layout = ColumnMajor)
+	{
+		resize(numChannels, numColumns, numBins, layout);
+	}
+
+	// resize() : set new dimensions and zero-fill the data
+	void resize(int numChannels, int numColumns, int numBins, Layout layout = ColumnMajor)
+	{
+		constexpr size_t elementsPerAlignment = std::max(size_t{1}, alignment / sizeof(T));
+
+		SpectrogramResults::numChannels = numChannels;
+		SpectrogramResults::numColumns = numColumns;
+		SpectrogramResults::numBins = numBins;
+		SpectrogramResults::layout = layout;
+
+		const size_t contiguousSize = static_cast<size_t>(layout == ColumnMajor ? numBins : numColumns);
+		const size_t otherSize = static_cast<size_t>(layout == ColumnMajor ? numColumns : numBins);
+		const size_t paddedSize = (contiguousSize + elementsPerAlignment - 1) / elementsPerAlignment * elementsPerAlignment;
+
+		if (layout == ColumnMajor) {
+			columnStride = static_cast<ptrdiff_t>(paddedSize);
+			binStride = 1;
+		} else {
+			columnStride = 1;
+			binStride = static_cast<ptrdiff_t>(paddedSize);
+		}
+
+		channelStride = static_cast<ptrdiff_t>(paddedSize * otherSize);
+		const size_t totalSize = static_cast<size_t>(channelStride) * static_cast<size_t>(numChannels);
+
+		if (totalSize > capacity) {
+			data.reset(static_cast<T*>(::operator new[](totalSize * sizeof(T), std::align_val_t{alignment})));
+			capacity = totalSize;
+		}
+
+		std::fill(data.get(), data.get() + totalSize, T{0});
+	}
+
+	int getNumChannels() const
+	{
+		return numChannels;
+	}
+
+	int getNumColumns() const
+	{
+		return numColumns;
+	}
+
+	int getNumBins() const
+	{
+		return numBins;
+	}
+
+	Layout getLayout() const
+	{
+		return layout;
+	}
+
+	// distance (in elements) between (x, b) and (x + 1, b)
+	ptrdiff_t getColumnStride() const
+	{
+		return columnStride;
+	}
+
+	// distance (in elements) between (x, b) and (x, b + 1)
+	ptrdiff_t getBinStride() const
+	{
+		return binStride;
+	}
+
+	// distance (in elements) between the start of one channel and the next
+	ptrdiff_t getChannelStride() const
+	{
+		return channelStride;
+	}
+
+	// getChannelSize() : number of elements in each channel (including padding)
+	size_t getChannelSize() const
+	{
+		return static_cast<size_t>(channelStride);
+	}
+
+	bool empty() const
+	{
+		return numChannels == 0;
+	}
+
+	// channel view : the whole of the data for channel c
+	T* channel(int c)
+	{
+		return data.get() + c * channelStride;
+	}
+
+	const T* channel(int c) const
+	{
+		return data.get() + c * channelStride;
+	}
+
+	// column view : bin zero of column x of channel c. Successive bins are getBinStride() elements apart
+	T* column(int c, int x)
+	{
+		return channel(c) + x * columnStride;
+	}
+
+	const T* column(int c, int x) const
+	{
+		return channel(c) + x * columnStride;
+	}
+
+	// row view : column zero of bin b of channel c. Successive columns are getColumnStride() elements apart
+	T* row(int c, int b)
+	{
+		return channel(c) + b * binStride;
+	}
+
+	const T* row(int c, int b) const
+	{
+		return channel(c) + b * binStride;
+	}
+
+	T& operator()(int c, int x, int b)
+	{
+		return channel(c)[x * columnStride + b * binStride];
+	}
+
+	const T& operator()(int c, int x, int b) const
+	{
+		return channel(c)[x * columnStride + b * binStride];
+	}
+
+private:
+	struct AlignedDeleter
+	{
+		void operator()(T* p) const
+		{
+			::operator delete[](p, std::align_val_t{alignment});
+		}
+	};
+
+	std::unique_ptr<T[], AlignedDeleter> data;
+	size_t capacity{0};
+	int numChannels{0};
+	int numColumns{0};
+	int numBins{0};
+	Layout layout{ColumnMajor};
+	ptrdiff_t columnStride{0};
+	ptrdiff_t binStride{0};
+	ptrdiff_t channelStride{0};
+};
+
+} // namespace Sndspec
+
+#endif // SPECTROGRAMRESULTS_H
@@ -8,53 +8,36 @@
 */
 
 #include "spectrum.h"
+#include "batch.h"
 #include "renderer.h"
 #include "reader.h"
 #include "window.h"
+#include "decibels.h"
+#include "decimator.h"
+#include "outofcorefft.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <filesystem>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <system_error>
 #include <vector>
 
 namespace Sndspec {
 
-// todo: this is only good for doubles: specialize for FloatType
+// Spectrum : double-precision Analyzer, with additional functions for magnitude and phase.
+// Spectrums are usually one-off (large) sizes, so their plans and buffers are not kept in the PlanCache
 Spectrum::Spectrum(int fft_size)
-	: fftSize(fft_size)
+	: Analyzer<double>(fft_size, 1, /* cached = */ false)
 {
-	spectrumSize = convertFFTSizeToSpectrumSize(fftSize);
-
-	tdBuf = static_cast<double*>(fftw_malloc(sizeof(double) * static_cast<size_t>(fftSize)));
-	fdBuf = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * static_cast<size_t>(fftSize)));
-	plan = fftw_plan_dft_r2c_1d(fftSize, tdBuf, fdBuf, FFTW_MEASURE | FFTW_PRESERVE_INPUT);
-}
-
-Spectrum::~Spectrum()
-{
-	fftw_destroy_plan(plan);
-	fftw_free(tdBuf);
-	fftw_free(fdBuf);
-}
-
-void Spectrum::exec()
-{
-	fftw_execute(plan);
-}
-
-int Spectrum::getFFTSize() const
-{
-	return fftSize;
-}
-
-int Spectrum::getSpectrumSize() const
-{
-	return spectrumSize;
 }
 
 int Spectrum::selectBestFFTSizeFromSpectrumSize(int spectrum_size)
@@ -64,14 +47,19 @@ int Spectrum::selectBestFFTSizeFromSpectrumSize(int spectrum_size)
 
 int Spectrum::selectBestFFTSize(int requested_size)
 {
-	int s = 1;
-
-	for (int ef : {1, 11, 13}) {
-		for (int d = 1; d <= requested_size; d *= 7) {
-			for (int c = 1; c <= requested_size; c *= 5) {
-				for (int b = 1; b <= requested_size; b *= 3) {
-					for (int a = 1; a <= requested_size; a *= 2) {
-						int t = a * b * c * d * ef;
+	return static_cast<int>(selectBestFFTSize(static_cast<int64_t>(requested_size)));
+}
+
+int64_t Spectrum::selectBestFFTSize(int64_t requested_size)
+{
+	int64_t s = 1;
+
+	for (int64_t ef : {1, 11, 13}) {
+		for (int64_t d = 1; d <= requested_size; d *= 7) {
+			for (int64_t c = 1; c <= requested_size; c *= 5) {
+				for (int64_t b = 1; b <= requested_size; b *= 3) {
+					for (int64_t a = 1; a <= requested_size; a *= 2) {
+						int64_t t = a * b * c * d * ef;
 						if (t > requested_size) {
 							break;
 						}
@@ -95,16 +83,6 @@ int Spectrum::convertFFTSizeToSpectrumSize(int fft_size)
 	return static_cast<int>(fft_size / 2.0) + 1;
 }
 
-double* Spectrum::getTdBuf() const
-{
-	return tdBuf;
-}
-
-const fftw_complex *Spectrum::getFdBuf() const
-{
-	return fdBuf;
-}
-
 void Spectrum::calcMag(std::vector<double>& buf)
 {
 	for (int b = 0; b < spectrumSize; b++) {
@@ -114,15 +92,6 @@ void Spectrum::calcMag(std::vector<double>& buf)
 	}
 }
 
-void Spectrum::calcMagSquared(std::vector<double>& buf)
-{
-	for (int b = 0; b < spectrumSize; b++) {
-		double re = fdBuf[b][0];
-		double im = fdBuf[b][1];
-		buf[static_cast<std::vector<double>::size_type>(b)] = re * re + im * im;
-	}
-}
-
 void Spectrum::calcPhase(std::vector<double>& buf)
 {
 	for (int b = 0; b < spectrumSize; b++) {
@@ -136,14 +105,11 @@ bool Spectrum::convertToDb(std::vector<std::vector<double>> &s, bool fromMagSqua
 {
 	int numChannels = s.size();
 	bool hasSignal{false};
-	int numBins = s.at(0).size();
 
 	// find peak
 	double peak{0.0};
 	for (int c = 0; c < numChannels; c++) {
-		for (int b = 0; b < numBins; b++) {
-			peak = std::max(peak, s[c][b]);
-		}
+		peak = std::max(peak, Decibels::findPeak(s[c].data(), s[c].size()));
 	}
 
 	if (std::fpclassify(peak) != FP_ZERO) { // scale the data
@@ -154,13 +120,8 @@ bool Spectrum::convertToDb(std::vector<std::vector<double>> &s, bool fromMagSqua
 		// set a floor to avoid log(0) problems
 		double floor = std::max(std::numeric_limits<double>::min(), peak * pow(10.0, -300.0 / dBMult)); // 300dB below peak or smallest normal number
 
-		// function to convert to dB
-		auto scaleFunc = [scale = 1.0 / peak, dBMult, floor] (double v) -> double {
-			return dBMult * std::log10(std::max(scale * v, floor));
-		};
-
 		for (int c = 0; c < numChannels; c++) {
-			std::transform(s[c].begin(), s[c].end(), s[c].begin(), scaleFunc);
+			Decibels::convert(s[c].data(), s[c].size(), 1.0 / peak, floor, dBMult);
 		}
 	}
 
@@ -170,13 +131,9 @@ bool Spectrum::convertToDb(std::vector<std::vector<double>> &s, bool fromMagSqua
 bool Spectrum::convertToDb(std::vector<double> &s, bool fromMagSquared)
 {
 	bool hasSignal{false};
-	const int numBins = s.size();
 
 	// find peak
-	double peak{0.0};
-	for (int b = 0; b < numBins; b++) {
-		peak = std::max(peak, s[b]);
-	}
+	const double peak = Decibels::findPeak(s.data(), s.size());
 
 	if (std::fpclassify(peak) != FP_ZERO) { // scale the data
 
@@ -186,12 +143,7 @@ bool Spectrum::convertToDb(std::vector<double> &s, bool fromMagSquared)
 		// set a floor to avoid log(0) problems
 		double floor = std::max(std::numeric_limits<double>::min(), peak * pow(10.0, -300.0 / dBMult)); // 300dB below peak or smallest normal number
 
-		// function to convert to dB
-		auto scaleFunc = [scale = 1.0 / peak, dBMult, floor] (double v) -> double {
-			return dBMult * std::log10(std::max(scale * v, floor));
-		};
-
-		std::transform(s.begin(), s.end(), s.begin(), scaleFunc);
+		Decibels::convert(s.data(), s.size(), 1.0 / peak, floor, dBMult);
 
 	}
 
@@ -248,6 +200,11 @@ void Spectrum::makeSpectrumFromFile(const Sndspec::Parameters &parameters)
 {
 	// prepare a renderer
 	Renderer renderer(parameters.getImgWidth(), parameters.getImgHeight());
+	PngWriter pngWriter;
+	pngWriter.setCompressionLevel(parameters.getPngLevel());
+	pngWriter.setIndexed(parameters.getPngPalette());
+	pngWriter.setNumThreads(getNumThreads(parameters.getThreads()));
+	renderer.setPngWriter(pngWriter);
 
 	// loop over the files
 	for (const std::string& inputFilename : parameters.getInputFiles()) {
@@ -265,60 +222,103 @@ void Spectrum::makeSpectrumFromFile(const Sndspec::Parameters &parameters)
 			nChannels = r.getNChannels();
 			sampleRate = r.getSamplerate();
 			renderer.setNyquist(sampleRate / 2);
+			renderer.setMinFreq(0.0);
 			renderer.setFreqStep(parameters.getFrequencyStep());
 		}
 
-		// calculate blocksize
-		int64_t startPos  = std::max(0, std::min(static_cast<int>(r.getSamplerate() * parameters.getStart()),  r.getNFrames()));
-		int64_t finishPos = (parameters.getFinish() == 0) ?
+		// calculate range
+		const int64_t startPos = std::max(INT64_C(0), std::min(static_cast<int64_t>(r.getSamplerate() * parameters.getStart()), r.getNFrames()));
+		const int64_t finishPos = (parameters.getFinish() == 0) ?
 			r.getNFrames() :
-			std::max(0, std::min(static_cast<int>(r.getSamplerate() * parameters.getFinish()), r.getNFrames()));
-		int interval = static_cast<int>(std::max(INT64_C(0), finishPos - startPos));
-		int blockSize = Spectrum::selectBestFFTSize(interval);
-		assert(blockSize <= interval);
-		r.setStartPos(startPos);
-		r.setFinishPos(startPos + blockSize);
-		r.setBlockSize(blockSize);
-
-		// create window
-		Sndspec::Window<double> window;
-		const double param
-				= parameters.getWindowFunctionParameters().empty() ?
-					   Sndspec::Window<double>::kaiserBetaFromDecibels(parameters.getDynRange())
-					 : parameters.getWindowFunctionParameters().at(0);
-		window.generate(parameters.getWindowFunction(), blockSize, param);
-
-		r.setWindow(window.getData());
-
-		// prepare the spectrum analyzers
-		std::vector<std::unique_ptr<Spectrum>> analyzers;
-		for (int ch = 0; ch < nChannels; ch ++) {
-			// create a spectrum analyzer for each channel if not already existing
-			analyzers.emplace_back(new Spectrum(blockSize));
-			r.setChannelBuffer(ch, analyzers.at(ch)->getTdBuf()); // give the reader direct write-access to the analyzer input buffer
-		}
-
-		// set a callback function to execute spectrum analysis for each block read
-		r.setProcessingFunc([&analyzers](int pos, int channel, const double* data) -> void {
-			(void)pos;
-			(void)data;
-			analyzers.at(channel)->exec();
-		});
+			std::max(INT64_C(0), std::min(static_cast<int64_t>(r.getSamplerate() * parameters.getFinish()), r.getNFrames()));
+		const int64_t interval = std::max(INT64_C(0), finishPos - startPos);
+
+		// a single FFT which would need more memory than the RAM budget is performed out-of-core (using scratch files).
+		// In Welch mode, the range is divided into overlapping segments. Otherwise, a single FFT covers the whole range
+		constexpr int64_t inCoreBytesPerPoint = 24; // (time-domain and frequency-domain buffers, and results)
+		const int64_t ramBudget = static_cast<int64_t>(parameters.getRamBudget()) << 20;
+		const bool zoom = parameters.hasFreqRange() && parameters.getHighFreq() > parameters.getLowFreq() && parameters.getLowFreq() < sampleRate / 2.0;
+		const bool welch = !zoom && parameters.getWelch() && interval > parameters.getWelchSegmentSize();
+		const bool outOfCore = !zoom && !welch && ramBudget > 0 && Spectrum::selectBestFFTSize(interval) * inCoreBytesPerPoint * nChannels > ramBudget;
+
+		auto makeWindow = [&parameters](int size) -> std::shared_ptr<const std::vector<double>> {
+			const double param
+					= parameters.getWindowFunctionParameters().empty() ?
+						   Sndspec::Window<double>::kaiserBetaFromDecibels(parameters.getDynRange())
+						 : parameters.getWindowFunctionParameters().at(0);
+			return Sndspec::Window<double>::getCached(parameters.getWindowFunction(), size, param);
+		};
 
-		// read (and analyze) the file
-		if (parameters.getChannelMode() == Sum) {
-			r.readSum();
-		} else if (parameters.getChannelMode() == Difference) {
-			r.readDifference();
+		std::vector<std::vector<double>> results;
+		if (zoom) {
+			double lowFreq = parameters.getLowFreq();
+			double highFreq = std::min(parameters.getHighFreq(), sampleRate / 2.0);
+			const int64_t analyzedFrames = calcZoomSpectrum(parameters, inputFilename, startPos, interval, lowFreq, highFreq, results);
+			r.setStartPos(startPos);
+			r.setFinishPos(startPos + analyzedFrames);
+
+			// the frequency axis covers only the band of interest, so make sure it gets enough tickmarks
+			renderer.setMinFreq(lowFreq);
+			renderer.setNyquist(highFreq);
+			if (parameters.getFrequencyStep() > (highFreq - lowFreq) / 4.0) {
+				renderer.setFreqStep(std::pow(10.0, std::floor(std::log10((highFreq - lowFreq) / 4.0))));
+			}
+		} else if (outOfCore) {
+			const int64_t fftSize = 2 * Spectrum::selectBestFFTSize(interval / 2); // (must be even)
+			if (!calcOutOfCoreSpectrum(parameters, inputFilename, startPos, fftSize, results)) {
+				std::cout << "couldn't create scratch files !" << std::endl;
+				continue;
+			}
+			r.setStartPos(startPos);
+			r.setFinishPos(startPos + fftSize);
+		} else if (welch) {
+			const int blockSize = Spectrum::selectBestFFTSize(parameters.getWelchSegmentSize());
+			const int hop = std::max(1, static_cast<int>(std::lround(blockSize * (1.0 - parameters.getWelchOverlap() / 100.0))));
+			const int numSegments = static_cast<int>((interval - blockSize) / hop + 1);
+			results.assign(nChannels, std::vector<double>(convertFFTSizeToSpectrumSize(blockSize), 0.0));
+
+			std::cout << "Averaging " << numSegments << " segments of " << blockSize << " samples" << std::endl;
+			calcWelchSpectrum(parameters, inputFilename, *makeWindow(blockSize), startPos, hop, numSegments, results);
+			r.setStartPos(startPos);
+			r.setFinishPos(startPos + static_cast<int64_t>(numSegments - 1) * hop + blockSize);
 		} else {
-			r.readDeinterleaved();
-		}
+			const int blockSize = static_cast<int>(Spectrum::selectBestFFTSize(std::min(interval, static_cast<int64_t>(std::numeric_limits<int>::max()))));
+			assert(blockSize <= interval);
+			results.assign(nChannels, std::vector<double>(convertFFTSizeToSpectrumSize(blockSize), 0.0));
+
+			r.setStartPos(startPos);
+			r.setFinishPos(startPos + blockSize);
+			r.setBlockSize(blockSize);
+			r.setWindow(*makeWindow(blockSize));
+
+			// prepare the spectrum analyzers
+			std::vector<std::unique_ptr<Spectrum>> analyzers;
+			for (int ch = 0; ch < nChannels; ch ++) {
+				// create a spectrum analyzer for each channel if not already existing
+				analyzers.emplace_back(new Spectrum(blockSize));
+				r.setChannelBuffer(ch, analyzers.at(ch)->getTdBuf()); // give the reader direct write-access to the analyzer input buffer
+			}
 
-		// prepare and populate results buffers
-		std::vector<std::vector<double>> results;
-		for (int ch = 0; ch < nChannels; ch ++) {
-			results.emplace_back(analyzers.at(ch)->getSpectrumSize(), 0.0);
-			analyzers.at(ch)->calcMagSquared(results.at(ch));
+			// set a callback function to execute spectrum analysis for each block read
+			r.setProcessingFunc([&analyzers](int pos, int channel, const double* data) -> void {
+				(void)pos;
+				(void)data;
+				analyzers.at(channel)->exec();
+			});
+
+			// read (and analyze) the file
+			if (parameters.getChannelMode() == Sum) {
+				r.readSum();
+			} else if (parameters.getChannelMode() == Difference) {
+				r.readDifference();
+			} else {
+				r.readDeinterleaved();
+			}
+
+			// populate results buffers
+			for (int ch = 0; ch < nChannels; ch ++) {
+				analyzers.at(ch)->calcMagSquared(results.at(ch));
+			}
 		}
 
 		bool hasSignal = false;
@@ -394,6 +394,287 @@ void Spectrum::makeSpectrumFromFile(const Sndspec::Parameters &parameters)
 	}
 }
 
+// calcWelchSpectrum() : average the magnitude-squared spectra of numSegments (windowed) segments, starting at startPos, hop samples apart.
+// Memory use depends only on the segment size (not on the length of the time range).
+// The segments are shared among threads, each of which has its own reader, analyzers and accumulators,
+// and the accumulators are summed once all the segments have been analyzed.
+void Spectrum::calcWelchSpectrum(const Parameters &parameters, const std::string &inputFilename, const std::vector<double> &window,
+								 int64_t startPos, int hop, int numSegments, std::vector<std::vector<double>> &results)
+{
+	const int segmentSize = static_cast<int>(window.size());
+	const int spectrumSize = convertFFTSizeToSpectrumSize(segmentSize);
+	const int nChannels = static_cast<int>(results.size());
+	const int numThreads = getNumThreads(parameters.getThreads());
+
+	// segments normally overlap, so it is best to stream, unless they are far apart
+	const bool streaming = (parameters.getReadMode() == ReadStream)
+			|| (parameters.getReadMode() == ReadAuto && hop <= 2 * segmentSize);
+
+	struct SegmentWorker
+	{
+		std::unique_ptr<Reader<double>> reader;
+		std::vector<std::unique_ptr<Analyzer<double>>> analyzers;
+		std::vector<std::vector<double>> accumulators;
+	};
+
+	std::vector<SegmentWorker> workers(numThreads);
+
+	runWorkStealing(numSegments, numThreads, /* chunkSize = */ 4, [&](int t, int64_t xBegin, int64_t xEnd) {
+		SegmentWorker& worker = workers.at(t);
+		if (worker.reader == nullptr) {
+			worker.reader.reset(new Reader<double>(inputFilename, segmentSize, numSegments));
+			worker.reader->setStartPos(startPos);
+			worker.reader->setFinishPos(startPos + static_cast<int64_t>(numSegments) * hop); // (makes the interval between segments equal to hop)
+			worker.reader->setWindow(window);
+			worker.reader->setStreaming(streaming);
+			for (int ch = 0; ch < nChannels; ch++) {
+				worker.analyzers.emplace_back(new Analyzer<double>(segmentSize));
+				worker.accumulators.emplace_back(spectrumSize, 0.0);
+				worker.reader->setChannelBuffer(ch, worker.analyzers.at(ch)->getTdBuf());
+			}
+
+			worker.reader->setProcessingFunc([&worker](int pos, int channel, const double* data) -> void {
+				(void)pos;
+				(void)data;
+				Analyzer<double>* analyzer = worker.analyzers.at(channel).get();
+				analyzer->exec();
+				analyzer->accumulateMagSquared(0, worker.accumulators.at(channel).data());
+			});
+		}
+
+		if (parameters.getChannelMode() == Sum) {
+			worker.reader->readSum(xBegin, xEnd);
+		} else if (parameters.getChannelMode() == Difference) {
+			worker.reader->readDifference(xBegin, xEnd);
+		} else {
+			worker.reader->readDeinterleaved(xBegin, xEnd);
+		}
+	});
+
+	// reduce
+	const double scale = 1.0 / numSegments;
+	for (int ch = 0; ch < nChannels; ch++) {
+		std::vector<double>& result = results.at(ch);
+		std::fill(result.begin(), result.end(), 0.0);
+		for (const SegmentWorker& worker : workers) {
+			if (!worker.accumulators.empty()) {
+				const std::vector<double>& acc = worker.accumulators.at(ch);
+				for (int b = 0; b < spectrumSize; b++) {
+					result[b] += acc[b];
+				}
+			}
+		}
+
+		for (double& v : result) {
+			v *= scale;
+		}
+	}
+}
+
+// calcZoomSpectrum() : magnitude-squared spectrum of only the band [lowFreq, highFreq] ("zoom FFT").
+// Each channel is shifted down and decimated by a Decimator, and the result is analyzed with a complex FFT.
+// This gives the same resolution within the band as a full FFT of the range, at a fraction of the size.
+// On return, lowFreq and highFreq are the frequencies of the first and last bins of the results.
+// Returns the number of frames analyzed.
+int64_t Spectrum::calcZoomSpectrum(const Parameters &parameters, const std::string &inputFilename, int64_t startPos, int64_t interval,
+								   double &lowFreq, double &highFreq, std::vector<std::vector<double>> &results)
+{
+	using Complex = FFTW<double>::Complex;
+	constexpr int chunkSize = 65536; // frames read at a time
+
+	Reader<double> probe(inputFilename, chunkSize, 1);
+	const int nChannels = probe.getNChannels();
+	const double sampleRate = probe.getSamplerate();
+
+	// choose a decimation factor which leaves room for the decimation filter's transition band
+	// (but which still leaves enough samples to analyze)
+	const double bandwidth = highFreq - lowFreq;
+	const double centerFreq = (lowFreq + highFreq) / 2.0;
+	int factor = static_cast<int>(std::max(INT64_C(1), std::min(static_cast<int64_t>(sampleRate / (1.5 * bandwidth)), interval / 64)));
+
+	// every output must lie entirely within the time range, so the filter must be shorter than the range
+	// (the filter length depends only on the decimation factor)
+	auto getFilterLength = [&](int f) -> int64_t {
+		return Decimator(f, centerFreq / sampleRate, bandwidth / sampleRate, parameters.getDynRange(), 0).getFilterLength();
+	};
+	int64_t filterLength = getFilterLength(factor);
+	while (factor > 1 && filterLength > interval / 2) {
+		factor /= 2;
+		filterLength = getFilterLength(factor);
+	}
+
+	// number of outputs whose inputs all lie within the range (the FFT size is no larger than this)
+	const int64_t numOutputs = std::max(INT64_C(1), (interval - filterLength) / factor + 1);
+	const int fftSize = static_cast<int>(selectBestFFTSize(std::min(numOutputs, static_cast<int64_t>(std::numeric_limits<int>::max()))));
+
+	// in sum and difference modes, only the first channel has any data
+	const int numActiveChannels = (parameters.getChannelMode() == Sum || parameters.getChannelMode() == Difference) ? 1 : nChannels;
+	std::vector<Decimator> decimators;
+	for (int ch = 0; ch < numActiveChannels; ch++) {
+		decimators.emplace_back(factor, centerFreq / sampleRate, bandwidth / sampleRate, parameters.getDynRange(), fftSize);
+	}
+
+	const int64_t inputRequired = std::min(interval, decimators.at(0).getInputRequired());
+	const int numChunks = static_cast<int>((inputRequired + chunkSize - 1) / chunkSize);
+	std::cout << "Zoom: decimating by " << factor << " (" << decimators.at(0).getFilterLength() << "-tap filter), "
+			  << fftSize << "-point FFT" << std::endl;
+
+	// read, shift and decimate all channels in one pass.
+	// (the reader reads whole chunks, which are chunkSize apart, but only the frames within the range are passed to the decimators)
+	Reader<double> reader(inputFilename, chunkSize, numChunks);
+	reader.setStartPos(startPos);
+	reader.setFinishPos(startPos + static_cast<int64_t>(numChunks) * chunkSize);
+	reader.setStreaming(true);
+	std::vector<std::vector<double>> chunkBuffers(nChannels, std::vector<double>(chunkSize, 0.0));
+	for (int ch = 0; ch < nChannels; ch++) {
+		reader.setChannelBuffer(ch, chunkBuffers.at(ch).data());
+	}
+
+	reader.setProcessingFunc([&decimators, numActiveChannels, inputRequired](int pos, int channel, const double* data) -> void {
+		if (channel < numActiveChannels) {
+			decimators.at(channel).process(data, std::min(static_cast<int64_t>(chunkSize), inputRequired - static_cast<int64_t>(pos) * chunkSize));
+		}
+	});
+
+	if (parameters.getChannelMode() == Sum) {
+		reader.readSum();
+	} else if (parameters.getChannelMode() == Difference) {
+		reader.readDifference();
+	} else {
+		reader.readDeinterleaved();
+	}
+
+	// create window
+	const double param
+			= parameters.getWindowFunctionParameters().empty() ?
+				   Sndspec::Window<double>::kaiserBetaFromDecibels(parameters.getDynRange())
+				 : parameters.getWindowFunctionParameters().at(0);
+	const auto window = Sndspec::Window<double>::getCached(parameters.getWindowFunction(), fftSize, param);
+	const std::vector<double>& w = *window;
+
+	// keep only the bins within the band
+	const double binWidth = sampleRate / factor / fftSize;
+	const int halfBins = std::min((fftSize - 1) / 2, static_cast<int>(bandwidth / 2.0 / binWidth));
+	lowFreq = centerFreq - halfBins * binWidth;
+	highFreq = centerFreq + halfBins * binWidth;
+	results.assign(nChannels, std::vector<double>(2 * halfBins + 1, 0.0));
+
+	Complex* buf = FFTW<double>::allocComplex(fftSize);
+	FFTW<double>::Plan plan;
+	{
+		std::lock_guard<std::mutex> lock(getPlannerMutex());
+		plan = FFTW<double>::planManyDFT(fftSize, 1, buf, buf, fftSize, FFTW_FORWARD, getPlannerEffort());
+	}
+
+	for (int ch = 0; ch < numActiveChannels; ch++) {
+		const std::vector<Decimator::Complex>& decimated = decimators.at(ch).getOutput();
+		for (int i = 0; i < fftSize; i++) {
+			const Decimator::Complex v = (i < static_cast<int>(decimated.size())) ? decimated[i] * w[i] : Decimator::Complex{};
+			buf[i][0] = v.real();
+			buf[i][1] = v.imag();
+		}
+
+		FFTW<double>::executeDFT(plan, buf, buf);
+
+		// negative frequencies (below centerFreq) are at the top of the transform
+		std::vector<double>& result = results.at(ch);
+		for (int j = -halfBins; j <= halfBins; j++) {
+			const int k = (j + fftSize) % fftSize;
+			result[j + halfBins] = buf[k][0] * buf[k][0] + buf[k][1] * buf[k][1];
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(getPlannerMutex());
+		FFTW<double>::destroyPlan(plan);
+	}
+	FFTW<double>::free(buf);
+
+	return inputRequired;
+}
+
+// calcOutOfCoreSpectrum() : transform each channel in turn with an OutOfCoreFFT, re-reading the file for each channel
+// (so that only one channel's scratch files exist at any time).
+// The spectrum of each channel is reduced to a number of bins which fits within the RAM budget, by keeping the maximum of each group of bins.
+// Returns false if the scratch files couldn't be created.
+bool Spectrum::calcOutOfCoreSpectrum(const Parameters &parameters, const std::string &inputFilename,
+									 int64_t startPos, int64_t fftSize, std::vector<std::vector<double>> &results)
+{
+	const size_t ramBudget = static_cast<size_t>(parameters.getRamBudget()) << 20;
+	constexpr int chunkSize = 65536; // frames read at a time
+	const int numChunks = static_cast<int>((fftSize + chunkSize - 1) / chunkSize);
+
+	std::error_code ec;
+	std::string scratchDirectory = std::filesystem::temp_directory_path(ec).string();
+	if (ec) {
+		scratchDirectory = ".";
+	}
+
+	Reader<double> reader(inputFilename, chunkSize, numChunks);
+	reader.setStartPos(startPos);
+	reader.setFinishPos(startPos + static_cast<int64_t>(numChunks) * chunkSize);
+	reader.setStreaming(true);
+	const int nChannels = reader.getNChannels();
+
+	std::vector<std::vector<double>> chunkBuffers(nChannels, std::vector<double>(chunkSize, 0.0));
+	for (int ch = 0; ch < nChannels; ch++) {
+		reader.setChannelBuffer(ch, chunkBuffers.at(ch).data());
+	}
+
+	// the results (of all channels) may use up to a quarter of the budget
+	const int64_t spectrumSize = fftSize / 2 + 1;
+	const int64_t maxBins = std::max(INT64_C(1), static_cast<int64_t>(ramBudget / 4 / (sizeof(double) * nChannels)));
+	const int64_t groupSize = (spectrumSize + maxBins - 1) / maxBins;
+	results.assign(nChannels, std::vector<double>(static_cast<size_t>((spectrumSize + groupSize - 1) / groupSize), 0.0));
+
+	// in sum and difference modes, only the first channel has any data
+	const int numActiveChannels = (parameters.getChannelMode() == Sum || parameters.getChannelMode() == Difference) ? 1 : nChannels;
+
+	const double param
+			= parameters.getWindowFunctionParameters().empty() ?
+				   Sndspec::Window<double>::kaiserBetaFromDecibels(parameters.getDynRange())
+				 : parameters.getWindowFunctionParameters().at(0);
+
+	for (int target = 0; target < numActiveChannels; target++) {
+		OutOfCoreFFT fft;
+		if (!fft.init(fftSize, ramBudget, scratchDirectory)) {
+			return false;
+		}
+
+		std::cout << "Out-of-core FFT: channel " << target << ", " << fftSize << " points (as " << fft.getRows() << " x " << fft.getColumns() << " complex)" << std::endl;
+
+		// the window is generated a chunk at a time, as it is needed
+		Sndspec::Window<double> window;
+		reader.setProcessingFunc([&](int pos, int channel, const double* data) -> void {
+			(void)data;
+			if (channel == target) {
+				const int64_t begin = static_cast<int64_t>(pos) * chunkSize;
+				const int64_t end = std::min(fftSize, begin + chunkSize);
+				window.generateSegment(parameters.getWindowFunction(), fftSize, begin, end, param);
+				const std::vector<double>& w = window.getData();
+				std::vector<double>& chunk = chunkBuffers.at(channel);
+				for (int64_t i = 0; i < end - begin; i++) {
+					chunk[i] *= w[i];
+				}
+				fft.writeInput(begin, chunk.data(), end - begin);
+			}
+		});
+
+		if (parameters.getChannelMode() == Sum) {
+			reader.readSum();
+		} else if (parameters.getChannelMode() == Difference) {
+			reader.readDifference();
+		} else {
+			reader.readDeinterleaved();
+		}
+
+		fft.exec();
+		fft.calcMagSquared(results.at(target));
+	}
+
+	return true;
+}
+
 void Spectrum::makeWindowFunctionPlot(const Parameters &parameters)
 {
 	const int w = parameters.getImgWidth();
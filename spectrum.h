@@ -10,11 +10,12 @@
 #ifndef SPECTRUM_H
 #define SPECTRUM_H
 
-#include <fftw3.h>
-
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <map>
 
+#include "analyzer.h"
 #include "parameters.h"
 
 namespace Sndspec {
@@ -23,20 +24,13 @@ static std::string replaceFileExt(const std::string &filename, const std::string
 static std::string getFilenameOnly(const std::string &path);
 static std::string enforceTrailingSeparator(const std::string &directory);
 
-class Spectrum
+class Spectrum : public Analyzer<double>
 {
 public:
 	Spectrum(int fft_size);
-	~Spectrum();
-	void exec();
 
-	double* getTdBuf() const;
-	const fftw_complex *getFdBuf() const;
 	void calcMag(std::vector<double>& buf);
-	void calcMagSquared(std::vector<double> &buf);
 	void calcPhase(std::vector<double>& buf);
-	int getFFTSize() const;
-	int getSpectrumSize() const;
 
 	static void makeSpectrumFromFile(const Sndspec::Parameters& parameters);
 	static void makeWindowFunctionPlot(const Sndspec::Parameters& parameters);
@@ -44,6 +38,7 @@ public:
 	static int convertFFTSizeToSpectrumSize(int fft_size);
 	static int selectBestFFTSizeFromSpectrumSize(int spectrum_size);
 	static int selectBestFFTSize(int requested_size); // pick a good FFT size for FFTW (of the form 2^a * 3^b * 5^c * 7^d * [1|11|13] )
+	static int64_t selectBestFFTSize(int64_t requested_size);
 
 	static bool convertToDb(std::vector<std::vector<double>> &s, bool fromMagSquared); // multi-channel
 	static bool convertToDb(std::vector<double> &s, bool fromMagSquared); // single-channel
@@ -56,13 +51,17 @@ public:
 	static bool plotAllWindows(bool timeDomain, bool whiteBackground);
 
 private:
-	fftw_plan plan;
-	int fftSize;
-	int spectrumSize;
+	// calcWelchSpectrum() : averaged magnitude-squared spectrum of overlapping segments (Welch's method)
+	static void calcWelchSpectrum(const Sndspec::Parameters& parameters, const std::string& inputFilename, const std::vector<double>& window,
+								  int64_t startPos, int hop, int numSegments, std::vector<std::vector<double>>& results);
+
+	// calcZoomSpectrum() : magnitude-squared spectrum of the band [lowFreq, highFreq] only, using a shifted and decimated signal (zoom FFT)
+	static int64_t calcZoomSpectrum(const Sndspec::Parameters& parameters, const std::string& inputFilename, int64_t startPos, int64_t interval,
+									double& lowFreq, double& highFreq, std::vector<std::vector<double>>& results);
 
-	// C -facing:
-	double* tdBuf;	// time-domain buffer
-	fftw_complex* fdBuf; // frequency-domain buffer
+	// calcOutOfCoreSpectrum() : magnitude-squared spectrum of a single FFT which is too large for the RAM budget, using scratch files
+	static bool calcOutOfCoreSpectrum(const Sndspec::Parameters& parameters, const std::string& inputFilename,
+									  int64_t startPos, int64_t fftSize, std::vector<std::vector<double>>& results);
 };
 
 std::string replaceFileExt(const std::string& filename, const std::string &newExt)
@@ -12,6 +12,16 @@
 #include "parameters.h"
 #include "window.h"
 #include "spectrum.h"
+#include "decibels.h"
+#include "outofcorefft.h"
+#include "analysiscache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <system_error>
+#include <vector>
 
 bool tests::testWindow()
 {
@@ -32,3 +42,147 @@ bool tests::testMinus3dbWidth()
 	std::cout << std::endl;
 	return true;
 }
+
+bool tests::testDecibels()
+{
+	// compare the vectorised kernels at each supported SimdLevel against the scalar reference
+	std::vector<double> input(1001);
+	for (size_t i = 0; i < input.size(); i++) {
+		input[i] = std::pow(10.0, -30.0 * std::sin(0.1 * i) * std::sin(0.1 * i));
+	}
+
+	std::vector<double> expected = input;
+	const double expectedPeak = Sndspec::Decibels::findPeakReference(expected.data(), expected.size());
+	Sndspec::Decibels::convertReference(expected.data(), expected.size(), 1.0 / expectedPeak, 1e-30, 10.0);
+
+	bool ok{true};
+	const auto initialLevel = Sndspec::Decibels::getSimdLevel();
+	for (int level = Sndspec::Decibels::SimdNone; level <= Sndspec::Decibels::getSupportedSimdLevel(); level++) {
+		Sndspec::Decibels::setSimdLevel(static_cast<Sndspec::Decibels::SimdLevel>(level));
+		std::vector<double> actual = input;
+		const double peak = Sndspec::Decibels::findPeak(actual.data(), actual.size());
+		Sndspec::Decibels::convert(actual.data(), actual.size(), 1.0 / peak, 1e-30, 10.0);
+		double maxError{0.0};
+		for (size_t i = 0; i < actual.size(); i++) {
+			maxError = std::max(maxError, std::abs(actual[i] - expected[i]));
+		}
+		const bool pass = (peak == expectedPeak) && (maxError < 0.01);
+		std::cout << Sndspec::Decibels::getSimdLevelName(static_cast<Sndspec::Decibels::SimdLevel>(level))
+				  << ": max error " << maxError << " dB " << (pass ? "ok" : "FAILED") << "\n";
+		ok = ok && pass;
+	}
+	Sndspec::Decibels::setSimdLevel(initialLevel);
+	std::cout << std::endl;
+	return ok;
+}
+
+bool tests::testOutOfCoreFFT()
+{
+	// compare the out-of-core FFT against an in-memory FFT of the same size
+	const int fftSize = 2310;
+	std::vector<double> input(fftSize);
+	for (int i = 0; i < fftSize; i++) {
+		input[i] = std::sin(0.3 * i) + 0.5 * std::cos(0.0071 * i * i);
+	}
+
+	Sndspec::OutOfCoreFFT outOfCore;
+	if (!outOfCore.init(fftSize, 0, std::filesystem::temp_directory_path().string())) {
+		std::cout << "couldn't create scratch files" << std::endl;
+		return false;
+	}
+	outOfCore.writeInput(0, input.data(), fftSize);
+	outOfCore.exec();
+	std::vector<double> actual(outOfCore.getSpectrumSize());
+	outOfCore.calcMagSquared(actual);
+
+	Sndspec::Spectrum inMemory(fftSize);
+	std::copy(input.begin(), input.end(), inMemory.getTdBuf());
+	inMemory.exec();
+	std::vector<double> expected(inMemory.getSpectrumSize());
+	inMemory.calcMagSquared(expected);
+
+	double maxError{0.0};
+	const double peak = *std::max_element(expected.begin(), expected.end());
+	for (size_t i = 0; i < expected.size(); i++) {
+		maxError = std::max(maxError, std::abs(actual[i] - expected[i]) / peak);
+	}
+	const bool pass = maxError < 1e-9;
+	std::cout << "out-of-core FFT (" << outOfCore.getRows() << " x " << outOfCore.getColumns() << "): max relative error " << maxError << " " << (pass ? "ok" : "FAILED") << "\n" << std::endl;
+	return pass;
+}
+
+// besselI0() : reference modified Bessel function of order 0, summed directly from its power series in long double
+// (std::cyl_bessel_i isn't available everywhere : libc++ doesn't provide the special math functions)
+static long double besselI0(long double x)
+{
+	const long double q = x * x / 4.0L;
+	long double term = 1.0L;
+	long double sum = 1.0L;
+	for (int k = 1; term > sum * std::numeric_limits<long double>::epsilon(); k++) {
+		term *= q / (static_cast<long double>(k) * k);
+		sum += term;
+	}
+	return sum;
+}
+
+bool tests::testKaiserWindow()
+{
+	// compare the Kaiser window (which uses a recurrence for the I0 series) against a direct summation of the series
+	bool ok{true};
+	for (double beta : {0.5, 8.6, 20.0, 40.0}) {
+		constexpr int size = 4097;
+		const auto w = Sndspec::Window<double>::getCached("kaiser", size, beta);
+		double maxError{0.0};
+		for (int n = 0; n < size; n++) {
+			const double x = 2.0 * n / (size - 1) - 1.0;
+			const double expected = static_cast<double>(besselI0(beta * std::sqrt(1.0L - x * x)) / besselI0(beta));
+			maxError = std::max(maxError, std::abs(w->at(n) - expected));
+		}
+		const bool pass = maxError < 1e-12;
+		std::cout << "beta " << beta << ": max error " << maxError << " " << (pass ? "ok" : "FAILED") << "\n";
+		ok = ok && pass;
+	}
+	std::cout << std::endl;
+	return ok;
+}
+
+bool tests::testAnalysisCache()
+{
+	// store some results, and check that they come back (as 32-bit floats) under the same key, and not under another key.
+	// (uses a temporary cache directory, which is removed afterwards)
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "sndspec-test-analysis-cache";
+	Sndspec::AnalysisCache::setDirectory(directory.string());
+
+	Sndspec::SpectrogramResults<double> results(2, 37, 19, Sndspec::SpectrogramResults<double>::BinMajor);
+	for (int c = 0; c < 2; c++) {
+		for (int x = 0; x < 37; x++) {
+			for (int b = 0; b < 19; b++) {
+				results(c, x, b) = std::pow(10.0, -0.5 * b) * (1.0 + 0.25 * std::sin(0.7 * x + c));
+			}
+		}
+	}
+
+	const std::string key{"test;columns=37;bins=19"};
+	if (!Sndspec::AnalysisCache::save(key, results, INT64_C(1) << 30)) {
+		std::cout << "couldn't save to analysis cache" << std::endl;
+		Sndspec::AnalysisCache::setDirectory({});
+		return false;
+	}
+
+	Sndspec::SpectrogramResults<double> loaded(2, 37, 19, Sndspec::SpectrogramResults<double>::BinMajor);
+	bool pass = Sndspec::AnalysisCache::load(key, loaded) && !Sndspec::AnalysisCache::load(key + ";other", loaded);
+	for (int c = 0; c < 2; c++) {
+		for (int x = 0; x < 37; x++) {
+			for (int b = 0; b < 19; b++) {
+				pass = pass && (loaded(c, x, b) == static_cast<float>(results(c, x, b)));
+			}
+		}
+	}
+
+	Sndspec::AnalysisCache::setDirectory({});
+	std::error_code ec;
+	std::filesystem::remove_all(directory, ec);
+
+	std::cout << "analysis cache round-trip " << (pass ? "ok" : "FAILED") << "\n" << std::endl;
+	return pass;
+}
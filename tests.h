@@ -15,6 +15,10 @@ class tests
 public:
 	static bool testWindow();
 	static bool testMinus3dbWidth();
+	static bool testDecibels();
+	static bool testOutOfCoreFFT();
+	static bool testKaiserWindow();
+	static bool testAnalysisCache();
 };
 
 #endif // TESTS_H
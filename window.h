@@ -10,14 +10,16 @@
 #ifndef WINDOW_H
 #define WINDOW_H
 
-#include "factorial.h"
-
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 #include <cmath>
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <string>
 
 #include <iostream>
@@ -147,81 +149,102 @@ public:
 
 	void generateRectangular(int size)
 	{
-		data.resize(size, 1.0);
+		generate({"rectangular", "Rectangular", Rectangular, {}}, size, 0.0);
 	}
 
 	// Triangular: first and last elements are NOT zero
 	void generateTriangular(int size)
 	{
-		data.resize(size, 0.0);
-		for (int n = 0 ; n < size; n++) {
-			data[n] = 1.0 - std::abs((n - (size - 1) / 2.0) / ((size + 1) / 2.0));
-		}
+		generate({"triangular", "Triangular", Triangular, {}}, size, 0.0);
 	}
 
 	// Bartlett: first and last elements are zero
 	void generateBartlett(int size)
 	{
-		data.resize(size, 0.0);
-		for (int n = 0 ; n < size; n++) {
-			data[n] = 1.0 - std::abs((n - (size - 1) / 2.0) / ((size - 1) / 2.0));
-		}
+		generate({"bartlett", "Bartlett", Bartlett, {}}, size, 0.0);
 	}
 
 	void generateWelch(int size)
 	{
-		data.resize(size, 0.0);
-		const double half_sizeMinus1 = static_cast<double>(size - 1) / 2.0;
-		for (int n = 0; n < size; n++) {
-			double t = (static_cast<double>(n) - half_sizeMinus1) / half_sizeMinus1;
-			data[n] = 1 - t * t;
-		}
+		generate({"welch", "Welch", Welch, {}}, size, 0.0);
 	}
 
 	void generalizedCosineWindow(int size, std::vector<FloatType> coeffs)
 	{
-		int N = size;
-		int K = coeffs.size();
-
-		Window<FloatType>::data.resize(size, 0.0);
-		for (int n = 0; n < size; ++n) {
-			FloatType s = 1.0; // sign
-			FloatType a = 0.0; // accumulator
-			for (int k = 0; k < K; k++) {
-				a += s * coeffs.at(k) * std::cos(2 * M_PI * k * n / (N - 1));
-				s = -s; // flip sign
-			}
-			data[n] = a;
-		}
+		generate({"cosinesum", "Cosine Sum", CosineSum, std::vector<double>(coeffs.begin(), coeffs.end())}, size, 0.0);
 	}
 
 	void generateKaiser(int size, FloatType beta)
 	{
-		data.resize(size, 0.0);
-		for (int n = 0; n < size; ++n) {
-			data[n] = I0(beta * sqrt(1.0 - pow((2.0 * n / (size - 1) - 1), 2.0))) / I0(beta);
-		}
+		generate({"kaiser", "Kaiser", Kaiser, {}}, size, beta);
 	}
 
 	void generate(std::string name, int size, FloatType val = 0.0)
 	{
-		const auto w = findWindow(name);
-		switch (w.windowType)
+		generate(findWindow(name), size, val);
+	}
+
+	// generate() : windows are symmetrical, so only the first half is evaluated; the second half is a mirror image of it
+	void generate(const WindowParameters& w, int size, FloatType val)
+	{
+		data.assign(std::max(0, size), 0.0);
+		const int half = (size + 1) / 2;
+		evaluate(w, size, 0, half, val, data.data());
+		std::reverse_copy(data.begin(), data.begin() + size / 2, data.begin() + half);
+	}
+
+	// generateSegment() : generate only elements [begin, end) of a window of the given size
+	// (for windows which are too large to hold in memory all at once)
+	void generateSegment(std::string name, int64_t size, int64_t begin, int64_t end, FloatType val = 0.0)
+	{
+		data.assign(end - begin, 0.0);
+		evaluate(findWindow(name), size, begin, end, val, data.data());
+	}
+
+	// getCached() : returns a shared, read-only window, which is only generated the first time it is requested.
+	// Windows are kept in a process-wide cache, keyed by (window, size, parameter).
+	// When the cache grows too large, windows which are no longer in use are evicted
+	static std::shared_ptr<const std::vector<FloatType>> getCached(const std::string& name, int size, FloatType val = 0.0)
+	{
+		using Key = std::tuple<std::string, int, FloatType>;
+		constexpr size_t maxCachedElements = size_t{1} << 24;
+		static std::mutex cacheMutex;
+		static std::map<Key, std::shared_ptr<const std::vector<FloatType>>> cache;
+		static size_t cachedElements{0};
+
+		const WindowParameters w = findWindow(name);
+		const bool hasParameter = (w.windowType == Kaiser || w.windowType == Unknown);
+		const Key key{w.name, size, hasParameter ? val : FloatType{0.0}};
 		{
-		case Rectangular:
-			return generateRectangular(size);
-		case Bartlett:
-			return generateBartlett(size);
-		case Triangular:
-			return generateTriangular(size);
-		case Welch:
-			return generateWelch(size);
-		case CosineSum:
-			return generalizedCosineWindow(size, w.coefficients);
-		case Kaiser:
-		case Unknown:
-			return generateKaiser(size, val);
+			std::lock_guard<std::mutex> lock(cacheMutex);
+			auto it = cache.find(key);
+			if (it != cache.end()) {
+				return it->second;
+			}
+		}
+
+		// (generate without holding the lock)
+		Window<FloatType> window;
+		window.generate(w, size, val);
+		auto p = std::make_shared<const std::vector<FloatType>>(std::move(window.data));
+
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		if (cachedElements + p->size() > maxCachedElements) {
+			for (auto it = cache.begin(); it != cache.end();) {
+				if (it->second.use_count() == 1) {
+					cachedElements -= it->second->size();
+					it = cache.erase(it);
+				} else {
+					++it;
+				}
+			}
 		}
+
+		auto [it, inserted] = cache.emplace(key, p);
+		if (inserted) {
+			cachedElements += p->size();
+		}
+		return it->second;
 	}
 
 	static WindowParameters findWindow(std::string name)
@@ -272,31 +295,122 @@ public:
 		return kaiserBeta;
 	}
 
-
 private:
 	std::vector<FloatType> data;
 
-	// I0() : 0th-order Modified Bessel function of the first kind:
-	static FloatType I0(FloatType z)
+	// evaluate() : write elements [begin, end) of a window of the given size to out
+	static void evaluate(const WindowParameters& w, int64_t size, int64_t begin, int64_t end, FloatType val, FloatType* out)
+	{
+		const double N = static_cast<double>(size);
+		switch (w.windowType)
+		{
+		case Rectangular:
+			std::fill(out, out + (end - begin), 1.0);
+			break;
+
+		case Bartlett:
+			for (int64_t n = begin; n < end; n++) {
+				out[n - begin] = 1.0 - std::abs((n - (N - 1) / 2.0) / ((N - 1) / 2.0));
+			}
+			break;
+
+		case Triangular:
+			for (int64_t n = begin; n < end; n++) {
+				out[n - begin] = 1.0 - std::abs((n - (N - 1) / 2.0) / ((N + 1) / 2.0));
+			}
+			break;
+
+		case Welch:
+			for (int64_t n = begin; n < end; n++) {
+				const double t = (static_cast<double>(n) - (N - 1) / 2.0) / ((N - 1) / 2.0);
+				out[n - begin] = 1 - t * t;
+			}
+			break;
+
+		case CosineSum:
+			evaluateCosineSum(w.coefficients, N, begin, end, out);
+			break;
+
+		case Kaiser:
+		case Unknown:
+			evaluateKaiser(val, N, begin, end, out);
+			break;
+		}
+	}
+
+	// evaluateCosineSum() : sum of a[k] * (-1)^k * cos(k * theta). Only cos(theta) is evaluated directly;
+	// the higher harmonics are obtained with the Chebyshev recurrence cos(k.theta) = 2cos(theta)cos((k-1)theta) - cos((k-2)theta)
+	static void evaluateCosineSum(const std::vector<double>& coeffs, double N, int64_t begin, int64_t end, FloatType* out)
+	{
+		const size_t K = coeffs.size();
+		const double thetaScale = 2 * M_PI / (N - 1);
+		for (int64_t n = begin; n < end; n++) {
+			const double c1 = std::cos(thetaScale * n);
+			double cPrev = 1.0; // cos(0)
+			double c = c1;
+			double a = (K > 0) ? coeffs[0] : 0.0;
+			double s = -1.0; // sign
+			for (size_t k = 1; k < K; k++) {
+				a += s * coeffs[k] * c;
+				const double cNext = 2.0 * c1 * c - cPrev;
+				cPrev = c;
+				c = cNext;
+				s = -s; // flip sign
+			}
+			out[n - begin] = a;
+		}
+	}
+
+	// evaluateKaiser() : Kaiser window, with I0 evaluated as the power series sum(((z/2)^k / k!)^2),
+	// using the recurrence term[k] = term[k - 1] * (z/2)^2 / k^2.
+	// Samples are processed in blocks, with the terms in the outer loop, so that the inner loop can be vectorised.
+	// The number of terms is chosen for the largest argument (ie beta), so that it suffices for every sample
+	static void evaluateKaiser(FloatType beta, double N, int64_t begin, int64_t end, FloatType* out)
 	{
-		FloatType result = 0.0;
-		FloatType oldResult = 0.0;
-		int k = 0;
-		do {
-			FloatType kfact = factorial[k];
-			oldResult = result;
+		if (N < 2.0) {
+			std::fill(out, out + (end - begin), 1.0);
+			return;
+		}
 
-			//	FloatType x = pow(z * z / 4.0, k) / (kfact * kfact); // square first
-			//	result += x;
+		const double qMax = 0.25 * beta * beta;
+		int numTerms = 0;
+		double i0Beta = 1.0;
+		for (double term = 1.0; term > i0Beta * 1e-17; ) {
+			numTerms++;
+			term *= qMax / (static_cast<double>(numTerms) * numTerms);
+			i0Beta += term;
+		}
 
-			FloatType x = pow(z / 2.0, k) / kfact;
-			result += x * x; // square last
+		std::vector<double> invKSquared(numTerms + 1);
+		for (int k = 1; k <= numTerms; k++) {
+			invKSquared[k] = 1.0 / (static_cast<double>(k) * k);
+		}
 
-			k++;
+		constexpr int64_t blockSize = 256;
+		double q[blockSize];
+		double term[blockSize];
+		double sum[blockSize];
+		for (int64_t b = begin; b < end; b += blockSize) {
+			const int64_t count = std::min(blockSize, end - b);
+			for (int64_t i = 0; i < count; i++) {
+				const double t = 2.0 * static_cast<double>(b + i) / (N - 1) - 1.0;
+				q[i] = qMax * std::max(0.0, 1.0 - t * t);
+				term[i] = 1.0;
+				sum[i] = 1.0;
+			}
 
-		} while (std::fpclassify(result - oldResult) == FP_NORMAL);
+			for (int k = 1; k <= numTerms; k++) {
+				const double r = invKSquared[k];
+				for (int64_t i = 0; i < count; i++) {
+					term[i] *= q[i] * r;
+					sum[i] += term[i];
+				}
+			}
 
-		return result;
+			for (int64_t i = 0; i < count; i++) {
+				out[b - begin + i] = sum[i] / i0Beta;
+			}
+		}
 	}
 };
 
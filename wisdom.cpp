@@ -0,0 +1,190 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#include "wisdom.h"
+#include "analyzer.h"
+#include "renderer.h"
+#include "spectrum.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <system_error>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace Sndspec {
+
+namespace fs = std::filesystem;
+
+std::string Wisdom::getDirectory()
+{
+#ifdef _WIN32
+	const char* localAppData = std::getenv("LOCALAPPDATA");
+	if (localAppData != nullptr && *localAppData != '\0') {
+		return (fs::path(localAppData) / "sndspec").string();
+	}
+#else
+	const char* xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+	if (xdgCacheHome != nullptr && *xdgCacheHome != '\0') {
+		return (fs::path(xdgCacheHome) / "sndspec").string();
+	}
+
+	const char* home = std::getenv("HOME");
+	if (home != nullptr && *home != '\0') {
+		return (fs::path(home) / ".cache" / "sndspec").string();
+	}
+#endif
+
+	return {};
+}
+
+// getSavedWisdom() : the wisdom as it was when last loaded or saved (so that it is only saved again if new wisdom has been added)
+template <typename FloatType>
+static std::string& getSavedWisdom()
+{
+	static std::string savedWisdom;
+	return savedWisdom;
+}
+
+template <typename FloatType>
+static std::string getWisdom()
+{
+	std::lock_guard<std::mutex> lock(getPlannerMutex());
+	return FFTW<FloatType>::exportWisdomToString();
+}
+
+template <typename FloatType>
+static bool importWisdom(const fs::path& filename)
+{
+	std::error_code ec;
+	if (!fs::exists(filename, ec)) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(getPlannerMutex());
+	return FFTW<FloatType>::importWisdom(filename.string().c_str());
+}
+
+// exportWisdom() : if there is any new wisdom, merge it with the file (which may have gained wisdom from concurrent instances of sndspec since it was loaded),
+// and write to a temporary file and then rename it, so that concurrent instances of sndspec never see a partially-written file
+template <typename FloatType>
+static bool exportWisdom(const fs::path& filename)
+{
+	if (getWisdom<FloatType>() == getSavedWisdom<FloatType>()) {
+		return true; // (nothing new)
+	}
+
+	importWisdom<FloatType>(filename);
+
+	const fs::path tmpFilename = fs::path(filename).concat(".tmp" + std::to_string(getpid()));
+
+	bool ok;
+	{
+		std::lock_guard<std::mutex> lock(getPlannerMutex());
+		ok = FFTW<FloatType>::exportWisdom(tmpFilename.string().c_str());
+	}
+
+	std::error_code ec;
+	if (ok) {
+		fs::rename(tmpFilename, filename, ec);
+	}
+
+	if (!ok || ec) {
+		fs::remove(tmpFilename, ec);
+		return false;
+	}
+
+	getSavedWisdom<FloatType>() = getWisdom<FloatType>();
+	return true;
+}
+
+bool Wisdom::load()
+{
+	const std::string directory = getDirectory();
+	if (directory.empty()) {
+		return false;
+	}
+
+	const bool loaded = importWisdom<double>(fs::path(directory) / "wisdom");
+	const bool loadedf = importWisdom<float>(fs::path(directory) / "wisdomf");
+	getSavedWisdom<double>() = getWisdom<double>();
+	getSavedWisdom<float>() = getWisdom<float>();
+	return loaded || loadedf;
+}
+
+bool Wisdom::save()
+{
+	const std::string directory = getDirectory();
+	if (directory.empty()) {
+		return false;
+	}
+
+	std::error_code ec;
+	fs::create_directories(directory, ec);
+	if (ec) {
+		return false;
+	}
+
+	const bool saved = exportWisdom<double>(fs::path(directory) / "wisdom");
+	const bool savedf = exportWisdom<float>(fs::path(directory) / "wisdomf");
+	return saved && savedf;
+}
+
+void Wisdom::setPlanEffort(FFTPlanEffort planEffort)
+{
+	switch (planEffort) {
+	case PlanEstimate:
+		getPlannerEffort() = FFTW_ESTIMATE;
+		break;
+	case PlanPatient:
+		getPlannerEffort() = FFTW_PATIENT;
+		break;
+	case PlanExhaustive:
+		getPlannerEffort() = FFTW_EXHAUSTIVE;
+		break;
+	case PlanMeasure:
+		getPlannerEffort() = FFTW_MEASURE;
+		break;
+	}
+}
+
+void Wisdom::warm(const Parameters &parameters, std::ostream &log)
+{
+	std::vector<int> heights = parameters.getWarmWisdomHeights();
+	if (heights.empty()) {
+		heights.push_back(parameters.getImgHeight());
+	}
+
+	// determine FFT sizes (which depend on the plot height, rather than the image height)
+	std::set<int> fftSizes;
+	for (int height : heights) {
+		const Renderer renderer(parameters.getImgWidth(), height);
+		fftSizes.insert(Spectrum::selectBestFFTSizeFromSpectrumSize(renderer.getPlotHeight()));
+	}
+
+	// plan each size, for single transforms and for batches
+	std::set<int> batchSizes{1, parameters.getFFTBatch()};
+	for (int fftSize : fftSizes) {
+		log << "Planning FFT size " << fftSize << " ... " << std::flush;
+		for (int batchSize : batchSizes) {
+			Analyzer<double> analyzer(fftSize, batchSize);
+			Analyzer<float> analyzerf(fftSize, batchSize);
+		}
+		log << "ok" << std::endl;
+	}
+}
+
+} // namespace Sndspec
@@ -0,0 +1,48 @@
+/*
+* Copyright (C) 2019 - 2026 Judd Niemann - All Rights Reserved.
+* You may use, distribute and modify this code under the
+* terms of the GNU Lesser General Public License, version 2.1
+*
+* You should have received a copy of GNU Lesser General Public License v2.1
+* with this file. If not, please refer to: https://github.com/jniemann66/ReSampler
+*/
+
+#ifndef WISDOM_H
+#define WISDOM_H
+
+#include "parameters.h"
+
+#include <ostream>
+#include <string>
+
+namespace Sndspec {
+
+// class Wisdom : persistent store of fftw wisdom (ie the results of measuring the speed of candidate plans).
+// Wisdom is kept in the user's cache directory ($XDG_CACHE_HOME/sndspec or ~/.cache/sndspec; %LOCALAPPDATA%\sndspec on Windows),
+// in separate files for double-precision (wisdom) and single-precision (wisdomf).
+// Loading the wisdom at startup lets measured plans for previously-seen FFT sizes be created almost instantly.
+
+class Wisdom
+{
+public:
+	// getDirectory() : returns directory for storing wisdom (or an empty string if it can't be determined)
+	static std::string getDirectory();
+
+	// load() : import wisdom for both precisions. Returns true if any wisdom was loaded
+	static bool load();
+
+	// save() : if any new plans have been made since load(), merge the accumulated wisdom for both precisions with the wisdom files
+	// (which may have been updated by other instances of sndspec), and save it. Returns true on success (or if there was nothing new to save)
+	static bool save();
+
+	// setPlanEffort() : set the planner effort used for all subsequent plans
+	static void setPlanEffort(FFTPlanEffort planEffort);
+
+	// warm() : create a plan for each FFT size used by spectrograms of the given image heights
+	// (or the configured image height if none given), in both precisions, so that their wisdom can be saved
+	static void warm(const Parameters& parameters, std::ostream& log);
+};
+
+} // namespace Sndspec
+
+#endif // WISDOM_H